@@ -0,0 +1,640 @@
+#include "json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+// Self-contained benchmark harness for the JSON library.
+// Every corpus is generated locally from a fixed seed, so numbers are comparable between runs and machines.
+//
+// Usage: json_benchmark [--filter <substring>] [--scale <n>] [--min-time <seconds>]
+
+using namespace JsonLibrary;
+
+// Counted from the worker threads of the parallel cases too
+static std::atomic<size_t> AllocationCount = 0;
+
+void* operator new(std::size_t Size)
+{
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* p = std::malloc(Size ? Size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+// What std::pmr::new_delete_resource() asks for, so PMR builds are counted too
+void* operator new(std::size_t Size, std::align_val_t Alignment)
+{
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	size_t Align = std::max(static_cast<size_t>(Alignment), sizeof(void*));
+	void* p = std::aligned_alloc(Align, (std::max<size_t>(Size, 1) + Align - 1) / Align * Align);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	std::free(p);
+}
+
+class BenchRandom
+{
+protected:
+	uint64_t State;
+
+public:
+	BenchRandom(uint64_t Seed) : State(Seed)
+	{
+	}
+
+	uint64_t Next()
+	{
+		// splitmix64
+		uint64_t z = (State += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	int Range(int Min, int Max)
+	{
+		return Min + static_cast<int>(Next() % static_cast<uint64_t>(Max - Min + 1));
+	}
+
+	double Real(double Min, double Max)
+	{
+		return Min + (Max - Min) * (static_cast<double>(Next() >> 11) / 9007199254740992.0);
+	}
+
+	bool Chance(int Percent)
+	{
+		return Range(0, 99) < Percent;
+	}
+};
+
+static void AppendUtf8(std::string& s, int CodePoint)
+{
+	if (CodePoint < 0x80)
+	{
+		s += static_cast<char>(CodePoint);
+	}
+	else if (CodePoint < 0x800)
+	{
+		s += static_cast<char>(0xC0 | (CodePoint >> 6));
+		s += static_cast<char>(0x80 | (CodePoint & 0x3F));
+	}
+	else
+	{
+		s += static_cast<char>(0xE0 | (CodePoint >> 12));
+		s += static_cast<char>(0x80 | ((CodePoint >> 6) & 0x3F));
+		s += static_cast<char>(0x80 | (CodePoint & 0x3F));
+	}
+}
+
+static const char* const Words[] =
+{
+	"json", "parser", "benchmark", "hello", "world", "stream", "value", "object", "array", "number",
+	"string", "token", "cache", "memory", "thread", "config", "update", "server", "client", "request",
+};
+
+// Tweet-like text: ASCII words, CJK runs and the occasional escape sequence written in JSON source form.
+static void AppendText(std::string& s, BenchRandom& r, int WordCount)
+{
+	for (int i = 0; i < WordCount; i++)
+	{
+		if (i) s += ' ';
+		switch (r.Range(0, 9))
+		{
+		case 0: case 1: case 2:
+			for (int j = r.Range(2, 8); j > 0; j--) AppendUtf8(s, r.Range(0x4E00, 0x9FA5));
+			break;
+		case 3:
+			for (int j = r.Range(2, 6); j > 0; j--) AppendUtf8(s, r.Range(0x3041, 0x3093));
+			break;
+		case 4:
+			s += r.Chance(50) ? "\\n" : "\\\"quoted\\\"";
+			break;
+		case 5:
+			s += "\\u3042\\u3044";
+			break;
+		default:
+			s += Words[r.Range(0, 19)];
+			break;
+		}
+	}
+}
+
+static void AppendId(std::string& s, BenchRandom& r, const char* Key, bool WithString)
+{
+	uint64_t id = 500000000000000000ull + r.Next() % 10000000000000000ull;
+	char buf[64];
+	snprintf(buf, sizeof buf, "\"%s\":%llu", Key, static_cast<unsigned long long>(id));
+	s += buf;
+	if (WithString)
+	{
+		snprintf(buf, sizeof buf, ",\"%s_str\":\"%llu\"", Key, static_cast<unsigned long long>(id));
+		s += buf;
+	}
+}
+
+static void AppendInt(std::string& s, const char* Key, long long Value)
+{
+	char buf[96];
+	snprintf(buf, sizeof buf, "\"%s\":%lld", Key, Value);
+	s += buf;
+}
+
+static std::string MakeTwitterLike(int Scale)
+{
+	BenchRandom r(0x7477697474657221ull);
+	std::string s;
+	int Statuses = 200 * Scale;
+	s += "{\"statuses\":[";
+	for (int i = 0; i < Statuses; i++)
+	{
+		if (i) s += ",";
+		s += "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},";
+		s += "\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",";
+		AppendId(s, r, "id", true);
+		s += ",\"text\":\"";
+		AppendText(s, r, r.Range(4, 24));
+		s += "\",\"source\":\"<a href=\\\"http://twitter.com/download/iphone\\\" rel=\\\"nofollow\\\">Twitter for iPhone</a>\",";
+		s += "\"truncated\":false,\"in_reply_to_status_id\":null,\"in_reply_to_user_id\":null,\"in_reply_to_screen_name\":null,";
+		s += "\"user\":{";
+		AppendId(s, r, "id", true);
+		s += ",\"name\":\"";
+		AppendText(s, r, 2);
+		s += "\",\"screen_name\":\"";
+		s += Words[r.Range(0, 19)];
+		s += "_";
+		s += Words[r.Range(0, 19)];
+		s += "\",\"location\":\"\",\"description\":\"";
+		AppendText(s, r, r.Range(0, 16));
+		s += "\",\"url\":null,\"entities\":{\"description\":{\"urls\":[]}},\"protected\":false,";
+		AppendInt(s, "followers_count", r.Range(0, 100000));
+		s += ",";
+		AppendInt(s, "friends_count", r.Range(0, 5000));
+		s += ",";
+		AppendInt(s, "listed_count", r.Range(0, 100));
+		s += ",\"created_at\":\"Mon Aug 25 12:06:44 +0000 2014\",";
+		AppendInt(s, "favourites_count", r.Range(0, 10000));
+		s += ",\"utc_offset\":null,\"time_zone\":null,\"geo_enabled\":false,\"verified\":false,";
+		AppendInt(s, "statuses_count", r.Range(0, 50000));
+		s += ",\"lang\":\"ja\",\"profile_background_color\":\"C0DEED\",";
+		s += "\"profile_image_url\":\"http://pbs.twimg.com/profile_images/503553738569560065/D_JW2dCJ_normal.jpeg\",";
+		s += "\"default_profile\":true,\"following\":false,\"notifications\":false},";
+		s += "\"geo\":null,\"coordinates\":null,\"place\":null,\"contributors\":null,";
+		AppendInt(s, "retweet_count", r.Range(0, 500));
+		s += ",";
+		AppendInt(s, "favorite_count", r.Range(0, 500));
+		s += ",\"entities\":{\"hashtags\":[";
+		for (int j = r.Range(0, 3), k = 0; k < j; k++)
+		{
+			if (k) s += ",";
+			s += "{\"text\":\"";
+			AppendText(s, r, 1);
+			s += "\",\"indices\":[";
+			s += std::to_string(k * 10) + "," + std::to_string(k * 10 + 8) + "]}";
+		}
+		s += "],\"symbols\":[],\"urls\":[],\"user_mentions\":[";
+		for (int j = r.Range(0, 2), k = 0; k < j; k++)
+		{
+			if (k) s += ",";
+			s += "{\"screen_name\":\"";
+			s += Words[r.Range(0, 19)];
+			s += "\",\"name\":\"";
+			AppendText(s, r, 2);
+			s += "\",";
+			AppendId(s, r, "id", true);
+			s += ",\"indices\":[0,12]}";
+		}
+		s += "]},\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}";
+	}
+	s += "],\"search_metadata\":{\"completed_in\":0.087,";
+	AppendId(s, r, "max_id", true);
+	s += ",\"next_results\":\"?max_id=505874847260352512&q=%E4%B8%80&count=100&include_entities=1\",";
+	s += "\"query\":\"%E4%B8%80\",\"refresh_url\":\"?since_id=505874924095815681&q=%E4%B8%80&include_entities=1\",";
+	s += "\"count\":100,\"since_id\":0,\"since_id_str\":\"0\"}}";
+	return s;
+}
+
+static std::string MakeCitmLike(int Scale)
+{
+	BenchRandom r(0x6369746D21212121ull);
+	std::string s;
+	int Areas = 17;
+	int Events = 184 * Scale;
+	int Performances = 600 * Scale;
+	s += "{\"areaNames\":{";
+	for (int i = 0; i < Areas; i++)
+	{
+		if (i) s += ",";
+		s += "\"" + std::to_string(205705993 + i) + "\":\"";
+		AppendText(s, r, 2);
+		s += "\"";
+	}
+	s += "},\"audienceSubCategoryNames\":{\"337100890\":\"Abonn\\u00e9\"},\"blockNames\":{},\"events\":{";
+	for (int i = 0; i < Events; i++)
+	{
+		if (i) s += ",";
+		int id = 138586341 + i * 4;
+		s += "\"" + std::to_string(id) + "\":{\"description\":null,";
+		AppendInt(s, "id", id);
+		s += ",\"logo\":";
+		s += r.Chance(30) ? "\"/images/UE0AAAAACEKo6QAAAAZDSVRN\"" : "null";
+		s += ",\"name\":\"";
+		AppendText(s, r, r.Range(1, 5));
+		s += "\",\"subTopicIds\":[337184269,337184283],\"subjectCode\":null,\"subtitle\":null,\"topicIds\":[324846099,107888604]}";
+	}
+	s += "},\"performances\":[";
+	for (int i = 0; i < Performances; i++)
+	{
+		if (i) s += ",";
+		s += "{";
+		AppendInt(s, "eventId", 138586341 + r.Range(0, Events - 1) * 4);
+		s += ",";
+		AppendInt(s, "id", 339887544 + i);
+		s += ",\"logo\":null,\"name\":null,\"prices\":[";
+		for (int j = r.Range(1, 5), k = 0; k < j; k++)
+		{
+			if (k) s += ",";
+			s += "{";
+			AppendInt(s, "amount", r.Range(5, 200) * 500);
+			s += ",\"audienceSubCategoryId\":337100890,";
+			AppendInt(s, "seatCategoryId", 338937295 + k);
+			s += "}";
+		}
+		s += "],\"seatCategories\":[";
+		for (int j = r.Range(1, 4), k = 0; k < j; k++)
+		{
+			if (k) s += ",";
+			s += "{\"areas\":[";
+			for (int a = r.Range(1, 10), b = 0; b < a; b++)
+			{
+				if (b) s += ",";
+				s += "{";
+				AppendInt(s, "areaId", 205705993 + r.Range(0, Areas - 1));
+				s += ",\"blockIds\":[]}";
+			}
+			s += "],";
+			AppendInt(s, "seatCategoryId", 338937295 + k);
+			s += "}";
+		}
+		s += "],\"seatMapImage\":null,";
+		AppendInt(s, "start", 1372616400000ll + static_cast<long long>(i) * 86400000ll);
+		s += ",\"venueCode\":\"PLEYEL_PLEYEL\"}";
+	}
+	s += "],\"seatCategoryNames\":{\"338937295\":\"1\\u00e8re cat\\u00e9gorie\",\"338937296\":\"2\\u00e8me cat\\u00e9gorie\"},";
+	s += "\"subTopicNames\":{\"337184262\":\"Musique amplifi\\u00e9e\",\"337184283\":\"Th\\u00e9\\u00e2tre\"},";
+	s += "\"subjectNames\":{},\"topicNames\":{\"107888604\":\"Activit\\u00e9\",\"324846099\":\"Concert\"},";
+	s += "\"topicSubTopics\":{\"107888604\":[337184283,337184263],\"324846099\":[337184269,337184262]},";
+	s += "\"venueNames\":{\"PLEYEL_PLEYEL\":\"Salle Pleyel\"}}";
+	return s;
+}
+
+static std::string MakeCanadaLike(int Scale)
+{
+	BenchRandom r(0x63616E6164612121ull);
+	std::string s;
+	int Rings = 240 * Scale;
+	char buf[96];
+	s += "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},";
+	s += "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+	for (int i = 0; i < Rings; i++)
+	{
+		if (i) s += ",";
+		s += "[";
+		double x = r.Real(-141.0, -52.0);
+		double y = r.Real(41.0, 83.0);
+		for (int j = r.Range(20, 400), k = 0; k < j; k++)
+		{
+			if (k) s += ",";
+			x += r.Real(-0.01, 0.01);
+			y += r.Real(-0.01, 0.01);
+			snprintf(buf, sizeof buf, "[%.15f,%.15f]", x, y);
+			s += buf;
+		}
+		s += "]";
+	}
+	s += "]}}]}";
+	return s;
+}
+
+static std::string MakeDeepNesting(int Scale)
+{
+	const int Depth = 1000;
+	std::string s;
+	int Chains = 16 * Scale;
+	s += "[";
+	for (int i = 0; i < Chains; i++)
+	{
+		if (i) s += ",";
+		for (int d = 0; d < Depth; d++) s += (d & 1) ? "{\"k\":" : "[";
+		s += "\"leaf\"";
+		for (int d = Depth - 1; d >= 0; d--) s += (d & 1) ? "}" : "]";
+	}
+	s += "]";
+	return s;
+}
+
+static size_t CountNodes(const JsonData& Json)
+{
+	size_t Count = 1;
+	switch (Json.GetType())
+	{
+	case JsonDataType::Object:
+		for (auto& kv : Json.AsJsonObject()) Count += CountNodes(*kv.second);
+		break;
+	case JsonDataType::Array:
+		for (auto& v : Json.AsJsonArray()) Count += CountNodes(*v);
+		break;
+	default:
+		break;
+	}
+	return Count;
+}
+
+// Looks every key up by name and every element up by index, the way application code navigates a document.
+static size_t LookupAll(const JsonData& Json)
+{
+	size_t Found = 0;
+	switch (Json.GetType())
+	{
+	case JsonDataType::Object:
+		if (1)
+		{
+			auto& Object = Json.AsJsonObject();
+			for (auto& kv : Object)
+			{
+				auto& Value = Object.at(kv.first.c_str());
+				Found += 1 + LookupAll(*Value);
+			}
+		}
+		break;
+	case JsonDataType::Array:
+		if (1)
+		{
+			auto& Array = Json.AsJsonArray();
+			for (size_t i = 0; i < Array.size(); i++)
+			{
+				Found += 1 + LookupAll(*Array.at(i));
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	return Found;
+}
+
+struct BenchCorpus
+{
+	std::string Name;
+	std::string Text;
+	std::string FilePath;
+	JsonDataPtr Document;
+	JsonDataPtr Document2;
+	size_t Nodes = 0;
+
+	BenchCorpus(std::string Name, std::string Text) : Name(std::move(Name)), Text(std::move(Text)) {}
+};
+
+struct BenchOptions
+{
+	std::string Filter;
+	int Scale = 1;
+	double MinTime = 0.5;
+};
+
+static volatile size_t Sink = 0;
+
+static void RunBenchmark(const BenchOptions& Options, const BenchCorpus& Corpus, const char* Operation, size_t Bytes, const std::function<void()>& Body)
+{
+	std::string FullName = Corpus.Name + "/" + Operation;
+	if (!Options.Filter.empty() && FullName.find(Options.Filter) == std::string::npos) return;
+
+	using Clock = std::chrono::steady_clock;
+
+	Body(); // Warm up caches and the allocator
+
+	size_t Iterations = 0;
+	size_t Allocations = AllocationCount;
+	auto Start = Clock::now();
+	double Elapsed = 0;
+	do
+	{
+		Body();
+		Iterations++;
+		Elapsed = std::chrono::duration<double>(Clock::now() - Start).count();
+	} while (Elapsed < Options.MinTime || Iterations < 3);
+	Allocations = AllocationCount - Allocations;
+
+	double Seconds = Elapsed / Iterations;
+	printf("%-32s %10.2f %12.2f %14.1f %10zu\n",
+		FullName.c_str(),
+		Bytes / Seconds / 1e6,
+		Seconds * 1e9 / Corpus.Nodes,
+		static_cast<double>(Allocations) / Iterations,
+		Iterations);
+	fflush(stdout);
+}
+
+static void RunCorpus(const BenchOptions& Options, BenchCorpus& Corpus)
+{
+	Corpus.Document = ParseJsonFromString(Corpus.Text);
+	Corpus.Document2 = ParseJsonFromString(Corpus.Text);
+	Corpus.Nodes = CountNodes(*Corpus.Document);
+
+	std::ofstream ofs(Corpus.FilePath, std::ios::binary);
+	ofs << Corpus.Text;
+	ofs.close();
+
+	size_t Bytes = Corpus.Text.size();
+	const JsonData& Doc = *Corpus.Document;
+	const JsonData& Doc2 = *Corpus.Document2;
+	size_t CompactBytes = Doc.ToString().size();
+	size_t IndentedBytes = Doc.ToString(4).size();
+
+	// Source retained, root touched: everything below it is spliced from the input
+	JsonParseOptions Retain;
+	Retain.RetainSource = true;
+	auto Spliced = ParseJsonFromString(Corpus.Text, Retain);
+	Spliced->Invalidate();
+	size_t SplicedBytes = ToStringSpliced(*Spliced).size();
+	size_t CanonicalBytes = ToStringCanonical(Doc).size();
+
+	RunBenchmark(Options, Corpus, "parse", Bytes, [&]()
+	{
+		auto Json = ParseJsonFromString(Corpus.Text);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+	JsonParseOptions Lazy;
+	Lazy.LazyNumbers = true;
+	RunBenchmark(Options, Corpus, "parse-lazy-numbers", Bytes, [&]()
+	{
+		auto Json = ParseJsonFromString(Corpus.Text, Lazy);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+	// Everything below the root's children is only checked; that includes copying the input for the deferred spans
+	JsonParseOptions LazySubtrees;
+	LazySubtrees.LazyDepth = 2;
+	RunBenchmark(Options, Corpus, "parse-lazy-subtrees", Bytes, [&]()
+	{
+		auto Json = ParseJsonFromString(Corpus.Text, LazySubtrees);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+	// Arrays of only numbers or only booleans stay buffers of doubles; the geometry corpus is mostly those
+	JsonParseOptions Typed;
+	Typed.TypedArrays = true;
+	RunBenchmark(Options, Corpus, "parse-typed-arrays", Bytes, [&]()
+	{
+		auto Json = ParseJsonFromString(Corpus.Text, Typed);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+	JsonReusableParser Reused;
+	RunBenchmark(Options, Corpus, "parse-reused", Bytes, [&]()
+	{
+		auto Json = Reused.Parse(Corpus.Text);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+#ifdef JSON_USE_PMR
+	JsonReusableParser Pooled({}, 1 << 16, true);
+	RunBenchmark(Options, Corpus, "parse-reused-pooled", Bytes, [&]()
+	{
+		auto Json = Pooled.Parse(Corpus.Text);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+	// Includes restoring the buffer the previous run rewrote
+	std::string InSitu;
+	RunBenchmark(Options, Corpus, "parse-insitu", Bytes, [&]()
+	{
+		InSitu.assign(Corpus.Text);
+		JsonInSituResource Resource(InSitu.data(), InSitu.size());
+		auto Json = ParseJsonInSitu(Resource);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+#endif
+	RunBenchmark(Options, Corpus, "validate", Bytes, [&]()
+	{
+		Sink = Sink + (ValidateJson(Corpus.Text) ? 1 : 0);
+	});
+	// Decodes every string and number for the schema, unlike plain validation
+	JsonSchema Schema(*ParseJsonFromString(R"({"type":["object","array"],"additionalProperties":{"type":["object","array","string","number","boolean","null"]}})"));
+	RunBenchmark(Options, Corpus, "validate-schema", Bytes, [&]()
+	{
+		Sink = Sink + (Schema.Validate(Corpus.Text) ? 1 : 0);
+	});
+
+	// Cut off in the middle, so the parse fails near the end
+	std::string Truncated = Corpus.Text.substr(0, Bytes / 2);
+	RunBenchmark(Options, Corpus, "reject-truncated", Truncated.size(), [&]()
+	{
+		auto Result = TryParseJsonFromString(Truncated);
+		Sink = Sink + static_cast<size_t>(Result.Error);
+	});
+	RunBenchmark(Options, Corpus, "serialize", CompactBytes, [&]()
+	{
+		Sink = Sink + Doc.ToString().size();
+	});
+	RunBenchmark(Options, Corpus, "serialize-indented", IndentedBytes, [&]()
+	{
+		Sink = Sink + Doc.ToString(4).size();
+	});
+	RunBenchmark(Options, Corpus, "serialize-utf8", CompactBytes, [&]()
+	{
+		JsonUtf8OutputScope Utf8;
+		Sink = Sink + Doc.ToString().size();
+	});
+	RunBenchmark(Options, Corpus, "serialize-parallel", CompactBytes, [&]()
+	{
+		Sink = Sink + ToStringParallel(Doc).size();
+	});
+	RunBenchmark(Options, Corpus, "serialize-spliced", SplicedBytes, [&]()
+	{
+		Sink = Sink + ToStringSpliced(*Spliced).size();
+	});
+	// Streamed into an FNV-1a hash, the way a content-addressed cache keys documents
+	RunBenchmark(Options, Corpus, "hash-canonical", CanonicalBytes, [&]()
+	{
+		uint64_t Hash = 0xcbf29ce484222325ull;
+		WriteJsonCanonical(Doc, [&](std::string_view s)
+		{
+			for (char c : s) Hash = (Hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+		});
+		Sink = Sink + static_cast<size_t>(Hash);
+	});
+	RunBenchmark(Options, Corpus, "lookup", Bytes, [&]()
+	{
+		Sink = Sink + LookupAll(Doc);
+	});
+	RunBenchmark(Options, Corpus, "copy", Bytes, [&]()
+	{
+		auto Json = Copy(Doc);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+	RunBenchmark(Options, Corpus, "equals", Bytes, [&]()
+	{
+		Sink = Sink + (Doc == Doc2 ? 1 : 0);
+	});
+	RunBenchmark(Options, Corpus, "load-file", Bytes, [&]()
+	{
+		auto Json = ParseJsonFromFile(Corpus.FilePath);
+		Sink = Sink + (Json ? 1 : 0);
+	});
+
+	std::remove(Corpus.FilePath.c_str());
+	Corpus.Document = nullptr;
+	Corpus.Document2 = nullptr;
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions Options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--filter") && i + 1 < argc) Options.Filter = argv[++i];
+		else if (!strcmp(argv[i], "--scale") && i + 1 < argc) Options.Scale = std::max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) Options.MinTime = atof(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Usage: %s [--filter <substring>] [--scale <n>] [--min-time <seconds>]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<BenchCorpus> Corpora;
+	Corpora.emplace_back("twitter", MakeTwitterLike(Options.Scale));
+	Corpora.emplace_back("citm_catalog", MakeCitmLike(Options.Scale));
+	Corpora.emplace_back("canada", MakeCanadaLike(Options.Scale));
+	Corpora.emplace_back("deep_nesting", MakeDeepNesting(Options.Scale));
+
+	printf("%-32s %10s %12s %14s %10s\n", "benchmark", "MB/s", "ns/node", "allocs/doc", "iters");
+	for (auto& Corpus : Corpora)
+	{
+		Corpus.FilePath = "json_benchmark_" + Corpus.Name + ".json";
+		RunCorpus(Options, Corpus);
+	}
+	return 0;
+}
@@ -3,6 +3,34 @@
 #include <sstream>
 #include <cctype>
 #include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <regex>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+#include <filesystem>
+#include <cerrno>
+#include <bit>
+#include <type_traits>
+#include <random>
+#include <cassert>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_USE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 // #include <format>
 
 namespace JsonLibrary
@@ -81,6 +109,200 @@ namespace JsonLibrary
 		return "<corrupted memory>";
 	}
 
+	void JsonStatistics::Reset()
+	{
+		*this = JsonStatistics();
+	}
+
+	JsonStatistics& JsonStatistics::operator += (const JsonStatistics& s)
+	{
+		Parses += s.Parses;
+		BytesParsed += s.BytesParsed;
+		for (size_t i = 0; i < sizeof Nodes / sizeof Nodes[0]; i++) Nodes[i] += s.Nodes[i];
+		if (MaxDepth < s.MaxDepth) MaxDepth = s.MaxDepth;
+		StringBytes += s.StringBytes;
+		Allocations += s.Allocations;
+		ParseSeconds += s.ParseSeconds;
+		Serializations += s.Serializations;
+		BytesSerialized += s.BytesSerialized;
+		SerializeSeconds += s.SerializeSeconds;
+		return *this;
+	}
+
+#ifdef JSON_STATISTICS
+	static thread_local JsonStatistics* CurrentStatistics = nullptr;
+	static thread_local int SerializeNesting = 0;
+
+	struct JsonParseThreshold
+	{
+		double LatencySeconds;
+		size_t Bytes;
+		JsonStatisticsCallback Callback;
+	};
+
+	static std::mutex ParseThresholdLock;
+	static std::shared_ptr<const JsonParseThreshold> ParseThreshold;
+
+	JsonStatisticsScope::JsonStatisticsScope(JsonStatistics& Stats) :
+		Previous(CurrentStatistics)
+	{
+		CurrentStatistics = &Stats;
+	}
+
+	JsonStatisticsScope::~JsonStatisticsScope()
+	{
+		CurrentStatistics = Previous;
+	}
+
+	void SetJsonParseThreshold(double LatencySeconds, size_t Bytes, JsonStatisticsCallback Callback)
+	{
+		std::shared_ptr<const JsonParseThreshold> t;
+		if (Callback) t = std::make_shared<JsonParseThreshold>(JsonParseThreshold{ LatencySeconds, Bytes, std::move(Callback) });
+		std::lock_guard<std::mutex> Lock(ParseThresholdLock);
+		ParseThreshold = std::move(t);
+	}
+
+	// Collected by the parser for a single document
+	class ParseStatistics
+	{
+	protected:
+		JsonStatistics Stats;
+		size_t Depth = 0;
+		std::chrono::steady_clock::time_point Start;
+
+	public:
+		void Begin(size_t Bytes)
+		{
+			Stats.Parses = 1;
+			Stats.BytesParsed = Bytes;
+			Start = std::chrono::steady_clock::now();
+		}
+
+		void End()
+		{
+			Stats.ParseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+			if (CurrentStatistics) *CurrentStatistics += Stats;
+
+			std::shared_ptr<const JsonParseThreshold> t;
+			if (1)
+			{
+				std::lock_guard<std::mutex> Lock(ParseThresholdLock);
+				t = ParseThreshold;
+			}
+			if (!t) return;
+			if ((t->LatencySeconds > 0 && Stats.ParseSeconds >= t->LatencySeconds) ||
+				(t->Bytes > 0 && Stats.BytesParsed >= t->Bytes)) t->Callback(Stats);
+		}
+
+		void Enter()
+		{
+			Depth += 1;
+			if (Stats.MaxDepth < Depth) Stats.MaxDepth = Depth;
+		}
+
+		void Leave()
+		{
+			Depth -= 1;
+		}
+
+		void Node(JsonDataType Type)
+		{
+			Stats.Nodes[static_cast<size_t>(Type)] += 1;
+			Stats.Allocations += 1;
+		}
+
+		void Member()
+		{
+			Stats.Allocations += 1;
+		}
+
+		void ArrayGrowth(const JsonArrayParentType& Array)
+		{
+			if (Array.size() == Array.capacity()) Stats.Allocations += 1;
+		}
+
+		void String(const JsonStringParentType& s)
+		{
+			// Strings up to what an empty one holds stay in the small-string buffer
+			static const size_t InlineCapacity = JsonStringParentType().capacity();
+			Stats.StringBytes += s.size();
+			if (s.size() > InlineCapacity) Stats.Allocations += 1;
+		}
+	};
+
+	// Times the outermost ToString() call on the current thread
+	class SerializeStatistics
+	{
+	protected:
+		std::chrono::steady_clock::time_point Start;
+		bool Tracked;
+		bool Outermost;
+
+	public:
+		SerializeStatistics() :
+			Tracked(CurrentStatistics != nullptr),
+			Outermost(Tracked && SerializeNesting++ == 0)
+		{
+			if (Outermost) Start = std::chrono::steady_clock::now();
+		}
+
+		~SerializeStatistics()
+		{
+			if (Tracked) SerializeNesting--;
+		}
+
+		std::string Finish(std::string s)
+		{
+			Finish(s.size());
+			return s;
+		}
+
+		// For output that was written out rather than returned
+		void Finish(size_t Bytes)
+		{
+			if (Outermost)
+			{
+				CurrentStatistics->Serializations += 1;
+				CurrentStatistics->BytesSerialized += Bytes;
+				CurrentStatistics->SerializeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+			}
+		}
+	};
+#else
+	JsonStatisticsScope::JsonStatisticsScope(JsonStatistics&) :
+		Previous(nullptr)
+	{
+	}
+
+	JsonStatisticsScope::~JsonStatisticsScope()
+	{
+	}
+
+	void SetJsonParseThreshold(double, size_t, JsonStatisticsCallback)
+	{
+	}
+
+	class ParseStatistics
+	{
+	public:
+		void Begin(size_t) {}
+		void End() {}
+		void Enter() {}
+		void Leave() {}
+		void Node(JsonDataType) {}
+		void Member() {}
+		void ArrayGrowth(const JsonArrayParentType&) {}
+		void String(const JsonStringParentType&) {}
+	};
+
+	class SerializeStatistics
+	{
+	public:
+		std::string Finish(std::string s) { return s; }
+		void Finish(size_t) {}
+	};
+#endif
+
 	template<typename NumType, int N>
 	std::string HexN(NumType num)
 	{
@@ -119,22 +341,310 @@ namespace JsonLibrary
 		return HexN<NumType, 4>(num);
 	}
 
+#ifdef JSON_USE_PMR
+	static std::string StdString(const JsonStringParentType& s)
+	{
+		return std::string(s.data(), s.size());
+	}
+#else
+	static const std::string& StdString(const std::string& s)
+	{
+		return s;
+	}
+#endif
+
+	// Message of the UnicodeDecodeError for a byte that does not decode
+	static std::string Utf8ErrorMessage(uint8_t Byte, bool Truncated)
+	{
+		std::stringstream ss;
+		ss << "can't decode byte 0x" << Hex2(Byte) << ": ";
+		if (Truncated) ss << "unexpected end of data";
+		else if ((Byte & 0xC0) == 0x80) ss << "invalid start byte";
+		else ss << "invalid byte";
+		return ss.str();
+	}
+
+	static bool IsSpace(int ch)
+	{
+		return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+	}
+
+	// Length of the run of printable ASCII other than '"' and '\\' at p, stopping at DEL too when asked.
+	// The escaper copies such runs as they are, and so does the string parser with DEL included.
+	static size_t CountPlainBytes(const char* p, size_t Size, bool StopAtDel)
+	{
+		size_t i = 0;
+#ifdef JSON_USE_SSE2
+		const __m128i Space = _mm_set1_epi8(0x20);
+		const __m128i Quote = _mm_set1_epi8('"');
+		const __m128i Backslash = _mm_set1_epi8('\\');
+		const __m128i Del = StopAtDel ? _mm_set1_epi8(0x7F) : Quote;
+		for (; i + 16 <= Size; i += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			// The compare is signed, so bytes from 0x80 on count as below 0x20 too
+			__m128i Special = _mm_or_si128(
+				_mm_or_si128(_mm_cmplt_epi8(v, Space), _mm_cmpeq_epi8(v, Quote)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, Backslash), _mm_cmpeq_epi8(v, Del)));
+			unsigned Mask = static_cast<unsigned>(_mm_movemask_epi8(Special));
+			if (Mask) return i + std::countr_zero(Mask);
+		}
+#else
+		// Eight bytes at a time in a 64-bit word; the byte loop below finds which one stopped it
+		const uint64_t Ones = 0x0101010101010101ull, Highs = 0x8080808080808080ull;
+		const uint64_t Del = StopAtDel ? Ones * 0x7F : Ones * '"';
+		for (; i + 8 <= Size; i += 8)
+		{
+			uint64_t w;
+			memcpy(&w, p + i, 8);
+			uint64_t q = w ^ (Ones * '"'), b = w ^ (Ones * '\\'), d = w ^ Del;
+			uint64_t Special = ((w - Ones * 0x20) | (q - Ones) | (b - Ones) | (d - Ones)) & ~w; // May overreport, never underreport
+			if ((Special | w) & Highs) break;
+		}
+#endif
+		for (; i < Size; i++)
+		{
+			uint8_t b = static_cast<uint8_t>(p[i]);
+			if (b < 0x20 || b == '"' || b == '\\' || b >= 0x80 || (StopAtDel && b == 0x7F)) break;
+		}
+		return i;
+	}
+
+	// Length of the well-formed UTF-8 sequence of two to four bytes at p, or 0 for anything else, including one cut off at
+	// the end of the buffer. Such sequences decode and encode back to the same bytes.
+	static size_t Utf8SequenceLength(const char* p, size_t Size)
+	{
+		auto Byte = [&](size_t i) { return static_cast<uint8_t>(p[i]); };
+		auto Continues = [&](size_t i, uint8_t Low, uint8_t High) { return i < Size && Byte(i) >= Low && Byte(i) <= High; };
+		uint8_t Lead = Byte(0);
+		if (Lead >= 0xC2 && Lead <= 0xDF) return Continues(1, 0x80, 0xBF) ? 2 : 0;
+		if (Lead >= 0xE0 && Lead <= 0xEF)
+		{
+			uint8_t Low = Lead == 0xE0 ? 0xA0 : 0x80, High = Lead == 0xED ? 0x9F : 0xBF; // No overlong forms or surrogates
+			return Continues(1, Low, High) && Continues(2, 0x80, 0xBF) ? 3 : 0;
+		}
+		if (Lead >= 0xF0 && Lead <= 0xF4)
+		{
+			uint8_t Low = Lead == 0xF0 ? 0x90 : 0x80, High = Lead == 0xF4 ? 0x8F : 0xBF; // Up to U+10FFFF
+			return Continues(1, Low, High) && Continues(2, 0x80, 0xBF) && Continues(3, 0x80, 0xBF) ? 4 : 0;
+		}
+		return 0;
+	}
+
+	// Length of the run at p that a string keeps as it is: the plain ASCII of CountPlainBytes() and well-formed UTF-8.
+	// It stops at '"', '\\', control characters and bytes that need decoding, such as malformed or cut off sequences.
+	static size_t CountStringBytes(const char* p, size_t Size)
+	{
+		size_t i = 0;
+		for (;;)
+		{
+			i += CountPlainBytes(p + i, Size - i, false);
+			if (i == Size || static_cast<uint8_t>(p[i]) < 0x80) return i;
+			size_t Sequence = Utf8SequenceLength(p + i, Size - i);
+			if (!Sequence) return i;
+			i += Sequence;
+		}
+	}
+
+	// Reads a file on a background thread into a ring of blocks, which the parser takes in order.
+	// Reading stays at most BlockCount blocks ahead of the parser.
+	class JsonReadAhead
+	{
+	protected:
+		std::ifstream File;
+		size_t FileSize;
+		std::vector<std::string> Blocks;
+		std::vector<size_t> Sizes;
+		size_t Filled; // Blocks read so far
+		size_t Taken; // Blocks handed to the parser and done with
+		bool Holding; // The parser still uses block Taken
+		bool Done;
+		bool Failed; // Reading stopped at an error rather than the end of the file
+		bool Stop;
+		std::mutex Lock;
+		std::condition_variable Cond;
+		std::thread Thread;
+
+		void Run()
+		{
+			for (;;)
+			{
+				size_t Index;
+				if (1)
+				{
+					std::unique_lock<std::mutex> Guard(Lock);
+					Cond.wait(Guard, [this]() { return Stop || Filled - Taken < Blocks.size(); });
+					if (Stop) return;
+					Index = Filled % Blocks.size();
+				}
+				auto& Block = Blocks[Index];
+				File.read(Block.data(), Block.size());
+				size_t Size = static_cast<size_t>(File.gcount());
+
+				std::lock_guard<std::mutex> Guard(Lock);
+				Sizes[Index] = Size;
+				if (Size) Filled++;
+				if (!Size || !File)
+				{
+					Failed = File.bad();
+					Done = true;
+					Cond.notify_all();
+					return;
+				}
+				Cond.notify_all();
+			}
+		}
+
+	public:
+		JsonReadAhead(const std::string& FilePath, size_t BlockSize, size_t BlockCount) :
+			File(FilePath, std::ios::binary),
+			FileSize(0),
+			Blocks(std::max<size_t>(BlockCount, 2)),
+			Sizes(Blocks.size()),
+			Filled(0),
+			Taken(0),
+			Holding(false),
+			Done(false),
+			Failed(false),
+			Stop(false)
+		{
+			if (!File) return;
+			File.seekg(0, std::ios::end);
+			FileSize = static_cast<size_t>(std::max<std::streamoff>(File.tellg(), 0));
+			File.seekg(0, std::ios::beg);
+			for (auto& Block : Blocks) Block.resize(std::max<size_t>(BlockSize, 1));
+			Thread = std::thread(&JsonReadAhead::Run, this);
+		}
+
+		~JsonReadAhead()
+		{
+			if (1)
+			{
+				std::lock_guard<std::mutex> Guard(Lock);
+				Stop = true;
+			}
+			Cond.notify_all();
+			if (Thread.joinable()) Thread.join();
+		}
+
+		bool IsOpen() const { return Thread.joinable(); }
+		size_t GetFileSize() const { return FileSize; }
+
+		// Whether the blocks ended at a read error, which the parser sees as the end of the input
+		bool ReadFailed()
+		{
+			std::lock_guard<std::mutex> Guard(Lock);
+			return Failed;
+		}
+
+		// Gives back the previous block and waits for the next one; empty at the end of the file
+		std::string_view Next()
+		{
+			std::unique_lock<std::mutex> Guard(Lock);
+			if (Holding)
+			{
+				Taken++;
+				Holding = false;
+				Cond.notify_all();
+			}
+			Cond.wait(Guard, [this]() { return Done || Filled > Taken; });
+			if (Filled == Taken) return std::string_view();
+			Holding = true;
+			size_t Index = Taken % Blocks.size();
+			return std::string_view(Blocks[Index].data(), Sizes[Index]);
+		}
+	};
+
 	class Utf8Parser
 	{
 	protected:
-		const std::string& s;
-		std::string::const_iterator it;
-		size_t LineNo;
-		size_t Column;
+		std::string_view s;
+		std::string_view::const_iterator it;
+
+		// When the input is streamed from Reader, s is a window on it that starts at offset Base.
+		// Refill() moves the window on, keeping the bytes from Keep on that the parser still needs.
+		JsonReadAhead* Reader;
+		std::string Window;
+		size_t Base;
+		size_t Keep;
+
+		// Set when parsing in situ: the writable buffer s views, where strings with escapes are decoded in place
+		char* InSitu;
+
+		// Line and column are not tracked per character but worked out from the offset when asked for.
+		// The cursor remembers the last position asked for, so asking in text order scans the text once.
+		mutable size_t CursorOffset;
+		mutable size_t CursorLineNo;
+		mutable size_t CursorColumn;
+		size_t OriginLineNo; // Position of the first character
+		size_t OriginColumn;
+
+		void MoveCursor(size_t Offset) const
+		{
+			if (Offset < CursorOffset)
+			{
+				if (Base || InSitu) return; // The text before the window is gone or rewritten; stay at the last position worked out
+				CursorOffset = 0;
+				CursorLineNo = OriginLineNo;
+				CursorColumn = OriginColumn;
+			}
+			const char* p = s.data() + (CursorOffset - Base);
+			const char* e = s.data() + (Offset - Base);
+			for (;;)
+			{
+				auto nl = static_cast<const char*>(memchr(p, '\n', e - p));
+				if (!nl) break;
+				CursorLineNo += 1;
+				CursorColumn = 1;
+				p = nl + 1;
+			}
+			for (; p < e; p++)
+			{
+				if ((*p & 0xC0) != 0x80) CursorColumn += 1;
+			}
+			CursorOffset = Offset;
+		}
 
 	public:
+		static constexpr int EndOfInput = -1;
+		static constexpr int InvalidUtf8 = -2;
+		static constexpr int TruncatedUtf8 = -3;
+
 		Utf8Parser() = delete;
-		Utf8Parser(const std::string& s) :
+		Utf8Parser(std::string_view s) :
 			s(s),
 			it(s.cbegin()),
-			LineNo(1),
-			Column(1)
+			Reader(nullptr),
+			Base(0),
+			Keep(SIZE_MAX),
+			InSitu(nullptr),
+			CursorOffset(0),
+			CursorLineNo(1),
+			CursorColumn(1),
+			OriginLineNo(1),
+			OriginColumn(1)
+		{
+		}
+
+		// Counts positions from LineNo and Column at the start of the text, for text cut out of a larger input
+		void SetOrigin(size_t LineNo, size_t Column)
+		{
+			CursorLineNo = OriginLineNo = LineNo;
+			CursorColumn = OriginColumn = Column;
+		}
+
+		// Starts over on new input, keeping the capacity of the buffers
+		void Reset(std::string_view Text)
 		{
+			s = Text;
+			it = s.cbegin();
+			Reader = nullptr;
+			Base = 0;
+			Keep = SIZE_MAX;
+			InSitu = nullptr;
+			CursorOffset = 0;
+			CursorLineNo = OriginLineNo = 1;
+			CursorColumn = OriginColumn = 1;
 		}
 
 		size_t GetUtf8CharLen(uint8_t FirstByte)
@@ -163,7 +673,7 @@ namespace JsonLibrary
 			{
 				std::stringstream ss;
 				ss << "can't decode byte 0x" << std::hex << static_cast<uint32_t>(FirstByte) << ": invalid start byte";
-				throw UnicodeDecodeError(LineNo, Column, ss.str());
+				throw UnicodeDecodeError(GetLineNo(), GetColumn(), ss.str());
 			}
 			else if ((FirstByte & 0x80) == 0x00)//0xxxxxxx
 			{
@@ -173,13 +683,19 @@ namespace JsonLibrary
 			{
 				std::stringstream ss;
 				ss << "can't decode byte 0x" << std::hex << static_cast<uint32_t>(FirstByte) << ": invalid start byte";
-				throw UnicodeDecodeError(LineNo, Column, ss.str());
+				throw UnicodeDecodeError(GetLineNo(), GetColumn(), ss.str());
 			}
 		}
 
-		static std::string EncodeUnicode(int Unicode)
+		static void AppendUnicode(std::string& Out, int Unicode)
+		{
+			char buf[8];
+			Out.append(buf, EncodeUnicode(buf, Unicode));
+		}
+
+		// Writes the UTF-8 form of Unicode to buf, which has room for 6 bytes, and returns its length
+		static size_t EncodeUnicode(char* buf, int Unicode)
 		{
-			char buf[8] = { 0 };
 			char* ch = buf;
 			if (Unicode < 0)
 			{
@@ -227,243 +743,559 @@ namespace JsonLibrary
 			{
 				*ch++ = (char)Unicode;
 			}
-			return buf;
+			return ch - buf;
 		}
 
-		int PeekChar(std::string::const_iterator* next = nullptr)
+		static std::string EncodeUnicode(int Unicode)
 		{
-			std::string::const_iterator cur = it;
-			size_t bytes;
-			uint32_t ret;
+			std::string Out;
+			AppendUnicode(Out, Unicode);
+			return Out;
+		}
 
-			if ((cur[0] & 0xFE) == 0xFC)//1111110x
+		// Streams the input from Reader instead of s
+		void SetReader(JsonReadAhead& From)
+		{
+			Reader = &From;
+			s = std::string_view();
+			it = s.cbegin();
+		}
+
+		// Parses a buffer that may be rewritten
+		void SetInSitu(char* Buffer, size_t Size)
+		{
+			InSitu = Buffer;
+			s = std::string_view(Buffer, Size);
+			it = s.cbegin();
+		}
+
+		// Takes the next block of a streamed input; false at the end of the input
+		bool Refill()
+		{
+			if (!Reader) return false;
+			auto Block = Reader->Next();
+			if (Block.empty())
 			{
-				ret =
-					(((uint32_t)cur[0] & 0x01) << 30) |
-					(((uint32_t)cur[1] & 0x3F) << 24) |
-					(((uint32_t)cur[2] & 0x3F) << 18) |
-					(((uint32_t)cur[3] & 0x3F) << 12) |
-					(((uint32_t)cur[4] & 0x3F) << 6) |
-					(((uint32_t)cur[5] & 0x3F) << 0);
-				bytes = 6;
+				Reader = nullptr;
+				return false;
 			}
-			else if ((cur[0] & 0xFC) == 0xF8)//111110xx
+
+			size_t Local = static_cast<size_t>(it - s.cbegin());
+			size_t From = Keep >= Base && Keep - Base < Local ? Keep - Base : Local;
+			if (CursorOffset < Base + From) MoveCursor(Base + From);
+			Window.erase(0, From);
+			Window.append(Block);
+			Base += From;
+			s = Window;
+			it = s.cbegin() + (Local - From);
+			return true;
+		}
+
+		// Decodes the character at the read position without consuming it.
+		// Returns EndOfInput, InvalidUtf8 or TruncatedUtf8 when there is no character to decode; *next is left alone then.
+		int PeekChar(std::string_view::const_iterator* next = nullptr)
+		{
+			if (it == s.cend() && !Refill()) return EndOfInput;
+			auto cur = reinterpret_cast<const uint8_t*>(&*it);
+			size_t avail = static_cast<size_t>(s.cend() - it);
+			size_t bytes;
+			uint32_t ret;
+
+			if ((cur[0] & 0x80) == 0x00)//0xxxxxxx
 			{
-				ret =
-					(((uint32_t)cur[0] & 0x03) << 24) |
-					(((uint32_t)cur[1] & 0x3F) << 18) |
-					(((uint32_t)cur[2] & 0x3F) << 12) |
-					(((uint32_t)cur[3] & 0x3F) << 6) |
-					(((uint32_t)cur[4] & 0x3F) << 0);
-				bytes = 5;
+				if (next) *next = it + 1;
+				return cur[0];
 			}
-			else if ((cur[0] & 0xF8) == 0xF0)//11110xxx
+			else if ((cur[0] & 0xE0) == 0xC0)//110xxxxx
 			{
-				ret =
-					(((uint32_t)cur[0] & 0x07) << 18) |
-					(((uint32_t)cur[1] & 0x3F) << 12) |
-					(((uint32_t)cur[2] & 0x3F) << 6) |
-					(((uint32_t)cur[3] & 0x3F) << 0);
-				bytes = 4;
+				ret = cur[0] & 0x1F;
+				bytes = 2;
 			}
 			else if ((cur[0] & 0xF0) == 0xE0)//1110xxxx
 			{
-				ret =
-					(((uint32_t)cur[0] & 0x0F) << 12) |
-					(((uint32_t)cur[1] & 0x3F) << 6) |
-					(((uint32_t)cur[2] & 0x3F) << 0);
+				ret = cur[0] & 0x0F;
 				bytes = 3;
 			}
-			else if ((cur[0] & 0xE0) == 0xC0)//110xxxxx
+			else if ((cur[0] & 0xF8) == 0xF0)//11110xxx
 			{
-				ret =
-					(((uint32_t)cur[0] & 0x1F) << 6) |
-					(((uint32_t)cur[1] & 0x3F) << 0);
-				bytes = 2;
+				ret = cur[0] & 0x07;
+				bytes = 4;
 			}
-			else if ((cur[0] & 0xC0) == 0x80)//10xxxxxx
+			else if ((cur[0] & 0xFC) == 0xF8)//111110xx
 			{
-				std::stringstream ss;
-				ss << "can't decode byte 0x" << Hex2(cur[0]) << ": invalid start byte";
-				throw UnicodeDecodeError(LineNo, Column, ss.str());
+				ret = cur[0] & 0x03;
+				bytes = 5;
 			}
-			else if ((cur[0] & 0x80) == 0x00)//0xxxxxxx
+			else if ((cur[0] & 0xFE) == 0xFC)//1111110x
 			{
-				ret = cur[0] & 0x7F;
-				bytes = 1;
+				ret = cur[0] & 0x01;
+				bytes = 6;
 			}
-			else
+			else // 10xxxxxx or 1111111x
 			{
-				std::stringstream ss;
-				ss << "can't decode byte " << Hex2(cur[0]) << ": invalid byte";
-				throw UnicodeDecodeError(LineNo, Column, ss.str());
+				return InvalidUtf8;
 			}
 
-			if (next) *next = cur + bytes;
+			if (bytes > avail) return Refill() ? PeekChar(next) : TruncatedUtf8;
+			for (size_t i = 1; i < bytes; i++) ret = (ret << 6) | (cur[i] & 0x3F);
+			if (next) *next = it + bytes;
 			return static_cast<int>(ret);
 		}
 
-		void UpdateLineNoColumn(int cur_char)
-		{
-			if (cur_char == '\n')
-			{
-				LineNo += 1;
-				Column = 0;
-			}
-			Column += 1;
-		}
-
 		int GetChar()
 		{
-			int ch = PeekChar(&it);
-			UpdateLineNoColumn(ch);
-			return ch;
+			return PeekChar(&it);
 		}
 
-		bool End() const { return it == s.cend(); }
-		size_t GetLineNo() const { return LineNo; }
-		size_t GetColumn() const { return Column; }
+		bool End() { return it == s.cend() && !Refill(); }
+		void Skip(size_t Bytes) { it += Bytes; } // Over characters known to be ASCII
+		size_t Offset() const { return Base + static_cast<size_t>(it - s.cbegin()); }
+		size_t GetLineNo(size_t Offset) const { MoveCursor(Offset); return CursorLineNo; }
+		size_t GetColumn(size_t Offset) const { MoveCursor(Offset); return CursorColumn; }
+		size_t GetLineNo() const { return GetLineNo(Offset()); }
+		size_t GetColumn() const { return GetColumn(Offset()); }
+	};
+
+	// Scan() handler of the plain validator: accepts everything, wants no values
+	class JsonNullHandler
+	{
+	public:
+		static constexpr bool WantsValues = false;
+		static constexpr bool ChecksRange = false;
+
+		bool StartObject() { return true; }
+		bool EndObject() { return true; }
+		bool StartArray() { return true; }
+		bool EndArray() { return true; }
+		bool Key(std::string_view) { return true; }
+		bool String(std::string_view) { return true; }
+		bool Number(double) { return true; }
+		bool Boolean(bool) { return true; }
+		bool Null() { return true; }
+		int GetFailure() const { return 0; }
+	};
+
+	// Scan() handler for the containers deferred by LazyDepth: numbers that could be out of range are converted as well,
+	// so that parsing their members later can't fail
+	class JsonLazyHandler : public JsonNullHandler
+	{
+	public:
+		static constexpr bool ChecksRange = true;
 	};
 
 	class JsonParser : public Utf8Parser
 	{
 	public:
+		ParseStatistics Stats;
+
 		JsonParser() = delete;
-		JsonParser(const std::string& s) : Utf8Parser(s)
+		JsonAllocatorType Alloc;
+		std::shared_ptr<const std::string> Source; // Set when the source spans are retained
+		bool TrackPositions;
+		bool AllowComments;
+		bool LazyNumbers;
+		bool TypedArrays = false;
+		size_t LazyDepth = SIZE_MAX;
+		JsonSourceSpan LazyText; // The text being parsed, shared by the containers deferred below LazyDepth
+#ifdef JSON_USE_PMR
+		JsonInSituResource* InSituResource = nullptr; // Alloc's resource when parsing in situ
+#endif
+
+		JsonParser(std::string_view s, const JsonAllocatorType& Alloc = {}) :
+			Utf8Parser(s),
+			Alloc(Alloc),
+			TrackPositions(true),
+			AllowComments(true),
+			LazyNumbers(false)
 		{
 		}
 
-		void SkipSpaces()
+		// Elements of the arrays being parsed, so each array is allocated once at its final size
+		std::vector<JsonDataPtr> Elements;
+
+		// Elements of a typed array being parsed, also as integers while they are all integer literals within int64_t,
+		// and where each one starts when positions are tracked
+		std::vector<double> TypedValues;
+		std::vector<int64_t> TypedIntegers;
+		bool TypedAllIntegers = false;
+		std::vector<std::pair<size_t, size_t>> TypedPositions;
+
+		// An object or array that is being parsed
+		struct Frame
 		{
-			std::string::const_iterator n;
-			if (End()) return;
-			for (;;)
-			{
-				int ch = PeekChar(&n);
-				if (isspace(ch))
-				{
-					UpdateLineNoColumn(ch);
-					it = n;
-					if (End()) break;
-				}
-				else break;
-			}
+			JsonDataPtr Container;
+			JsonObject* Object;
+			JsonArray* Array;
+			JsonObject::iterator Member; // Where the value being parsed goes, in an object
+			size_t Offset; // Of the opening bracket
+			size_t First; // Index in Elements of the first element, in an array
+		};
+		std::vector<Frame> Frames;
+		size_t MaxDepth = SIZE_MAX;
+
+		void Reset(std::string_view Text)
+		{
+			Utf8Parser::Reset(Text);
+			Stats = ParseStatistics();
+			Source.reset();
+			LazyText.reset();
+			Error = JsonErrorCode::None;
+			ErrorOffset = 0;
+			ErrorChar = 0;
+			Elements.clear();
+			Frames.clear();
+			TypedValues.clear();
+			TypedIntegers.clear();
+			TypedPositions.clear();
 		}
 
-		void SkipUntilChar(int Char)
+		// Gives back the scratch buffers that grew beyond MaxBytes
+		void Trim(size_t MaxBytes)
 		{
-			while (GetChar() != Char) if (End()) break;
+			Frames.clear();
+			if (Frames.capacity() * sizeof(Frame) > MaxBytes) std::vector<Frame>().swap(Frames);
+			Elements.clear();
+			if (Elements.capacity() * sizeof(JsonDataPtr) > MaxBytes) std::vector<JsonDataPtr>().swap(Elements);
+			TypedValues.clear();
+			if (TypedValues.capacity() * sizeof(double) > MaxBytes) std::vector<double>().swap(TypedValues);
+			TypedIntegers.clear();
+			if (TypedIntegers.capacity() * sizeof(int64_t) > MaxBytes) std::vector<int64_t>().swap(TypedIntegers);
+			TypedPositions.clear();
+			if (TypedPositions.capacity() * sizeof(TypedPositions[0]) > MaxBytes) decltype(TypedPositions)().swap(TypedPositions);
+			if (StringBuffer.capacity() > MaxBytes) std::string().swap(StringBuffer);
 		}
 
-		void SkipSpacesAndComments()
+		// Where the next node starts, or 0, 0 when the nodes don't keep positions
+		void GetNodePosition(size_t& LineNo, size_t& Column) const
 		{
-			std::string::const_iterator n;
-			std::stringstream ss;
-
-			for (;;)
+			if (TrackPositions)
 			{
-				SkipSpaces();
-				if (End()) return;
-				int ch = PeekChar(&n);
-				if (ch != '/') return;
-				UpdateLineNoColumn(ch);
-				it = n;
-				int next = GetChar();
-				switch (next)
-				{
-				case '/': // Single line comment
-					SkipUntilChar('\n');
-					continue;
-				case '*': /* Multiline comment */
-					for (;;)
-					{
-						SkipUntilChar('*');
-						if (End()) throw JsonDecodeError(LineNo, Column, "Expected */");
-						ch = PeekChar(&n);
-						if (ch == '/')
-						{
-							UpdateLineNoColumn(ch);
-							it = n;
-							break;
-						}
-					}
-					continue;
-				default:
-					ss << "Unexpected " << EncodeUnicode(next);
-					throw JsonDecodeError(LineNo, Column, ss.str());
-				}
+				size_t Cur = Offset();
+				LineNo = GetLineNo(Cur);
+				Column = GetColumn(Cur);
 			}
+			else LineNo = Column = 0;
 		}
 
-		std::string ParseString()
+		JsonSourceSpan SourceSpan(size_t Begin) const
+		{
+			if (!Source) return JsonSourceSpan();
+			return JsonSourceSpan(Source, Begin, Offset());
+		}
+
+		// What a container deferred here needs to parse its members the way this parse would have
+		uint8_t LazyFlags() const
+		{
+			uint8_t Flags = JsonLazyContent::Pending;
+			if (TrackPositions) Flags |= JsonLazyContent::TrackPositions;
+			if (AllowComments) Flags |= JsonLazyContent::AllowComments;
+			if (LazyNumbers) Flags |= JsonLazyContent::LazyNumbers;
+			if (TypedArrays) Flags |= JsonLazyContent::TypedArrays;
+			return Flags;
+		}
+
+		// The first error wins; the parse functions return early once it is set.
+		JsonErrorCode Error = JsonErrorCode::None;
+		size_t ErrorOffset = 0;
+		int ErrorChar = 0;
+
+		bool Failed() const { return Error != JsonErrorCode::None; }
+
+		bool Fail(JsonErrorCode Code, size_t At, int Char = 0)
+		{
+			if (!Failed())
+			{
+				Error = Code;
+				ErrorOffset = At;
+				ErrorChar = Char;
+			}
+			return false;
+		}
+
+		// Records why PeekChar() or GetChar() returned no character
+		bool FailChar(int ch)
+		{
+			if (ch == EndOfInput) return Fail(JsonErrorCode::UnexpectedEnd, Offset());
+			return Fail(ch == TruncatedUtf8 ? JsonErrorCode::TruncatedUtf8 : JsonErrorCode::InvalidUtf8, Offset(), static_cast<uint8_t>(*it));
+		}
+
+		// Records an unexpected character that was just read
+		bool FailUnexpected(int ch)
+		{
+			if (ch < 0) return FailChar(ch);
+			return Fail(JsonErrorCode::UnexpectedCharacter, Offset(), ch);
+		}
+
+		JsonParseResult GetErrorResult() const
+		{
+			JsonParseResult Result;
+			Result.Error = Error;
+			Result.Offset = ErrorOffset;
+			Result.LineNo = GetLineNo(ErrorOffset);
+			Result.Column = GetColumn(ErrorOffset);
+			Result.Character = ErrorChar;
+			return Result;
+		}
+
+		void SkipSpaces()
+		{
+			std::string_view::const_iterator n = it;
+			for (;;)
+			{
+				int ch = PeekChar(&n);
+				if (!IsSpace(ch)) break;
+				it = n;
+			}
+		}
+
+		bool SkipUntilChar(int Char)
 		{
-			std::stringstream ss;
 			for (;;)
 			{
 				int ch = GetChar();
-				if (ch >= 0 && ch < 0x20) throw JsonDecodeError(LineNo, Column, "Invalid control character");
-				switch (ch)
+				if (ch == Char) return true;
+				if (ch < 0) return ch == EndOfInput || FailChar(ch);
+			}
+		}
+
+		bool SkipSpacesAndComments()
+		{
+			std::string_view::const_iterator n = it;
+
+			for (;;)
+			{
+				SkipSpaces();
+				int ch = PeekChar(&n);
+				if (ch != '/' || !AllowComments) return ch >= EndOfInput || FailChar(ch);
+				it = n;
+				int next = GetChar();
+				switch (next)
 				{
-				case '\\':
-					if (1)
+				case '/': // Single line comment
+					if (!SkipUntilChar('\n')) return false;
+					continue;
+				case '*': /* Multiline comment */
+					for (;;)
 					{
-						int ch2 = GetChar();
-						std::stringstream buf;
-						switch (ch2)
+						if (!SkipUntilChar('*')) return false;
+						if (End()) return Fail(JsonErrorCode::UnterminatedComment, Offset());
+						ch = PeekChar(&n);
+						if (ch == '/')
 						{
-						case '"': ss << '"'; break;
-						case '\\': ss << '\\'; break;
-						case '/': ss << '/'; break;
-						case 'b': ss << '\b'; break;
-						case 'f': ss << '\f'; break;
-						case 'n': ss << '\n'; break;
-						case 'r': ss << '\r'; break;
-						case 't': ss << '\t'; break;
-						case 'u':
-							for (int i = 0; i < 4; i++)
-							{
-								int c = GetChar();
-								if (!isxdigit(c)) throw JsonDecodeError(LineNo, Column, "Invalid \\escape");
-								buf << static_cast<char>(c);
-							}
-							ss << EncodeUnicode(std::stoi(buf.str(), nullptr, 16));
+							it = n;
 							break;
-						default:
-							throw JsonDecodeError(LineNo, Column, "Invalid \\escape");
 						}
 					}
-					break;
+					continue;
 				default:
-					ss << EncodeUnicode(ch);
-				case '"':
-					break;
+					return FailUnexpected(next);
 				}
-				if (ch == '"') break;
 			}
-			return ss.str();
+		}
+
+		// Strings with escapes are decoded here; it keeps its capacity from one string to the next
+		std::string StringBuffer;
+
+		// What each character after a backslash stands for; 'u' for \uXXXX, 0 for an invalid escape
+		static char UnescapeChar(int ch)
+		{
+			switch (ch)
+			{
+			case '"': return '"';
+			case '\\': return '\\';
+			case '/': return '/';
+			case 'b': return '\b';
+			case 'f': return '\f';
+			case 'n': return '\n';
+			case 'r': return '\r';
+			case 't': return '\t';
+			case 'u': return 'u';
+			}
+			return 0;
+		}
+
+		static int HexDigit(int ch)
+		{
+			if (ch >= '0' && ch <= '9') return ch - '0';
+			ch |= 0x20;
+			if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+			return -1;
+		}
+
+		// Reads the four digits of a \u escape, or returns -1 after recording the error
+		int ParseHex4()
+		{
+			int Unit = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				int Digit = HexDigit(GetChar());
+				if (Digit < 0)
+				{
+					Fail(JsonErrorCode::InvalidEscape, Offset());
+					return -1;
+				}
+				Unit = Unit * 16 + Digit;
+			}
+			return Unit;
+		}
+
+		// Reads the rest of a string whose opening quote was read already.
+		// A string without escapes is returned as a view of the input, others are decoded into StringBuffer,
+		// or over their own text when parsing in situ; out of situ the result is only valid until the parser reads on.
+		// Empty on failure.
+		std::string_view ParseString()
+		{
+			bool Buffered = false;
+			char* Start = InSitu ? InSitu + (it - s.cbegin()) : nullptr;
+			char* Write = Start; // The decoded text is never longer than its source, so it stays behind the read position
+			int HighSurrogate = 0; // A \uD800-\uDBFF waiting for the \uDC00-\uDFFF that completes it
+			for (;;)
+			{
+				// Copy the characters up to the next quote, backslash, control character or malformed UTF-8 in one go
+				const char* p = s.data() + (it - s.cbegin());
+				size_t Avail = static_cast<size_t>(s.cend() - it);
+				size_t Plain = CountStringBytes(p, Avail);
+				if (!Buffered && Plain < Avail && p[Plain] == '"')
+				{
+					it += Plain + 1;
+					return std::string_view(p, Plain);
+				}
+				if (!Buffered)
+				{
+					if (InSitu)
+					{
+						// Check the string and move the cursor past it before its text is rewritten, so errors and positions
+						// are still worked out from the original text
+						auto From = it;
+						if (!SkipString()) return std::string_view();
+						MoveCursor(Offset());
+						it = From;
+					}
+					else StringBuffer.clear();
+					Buffered = true;
+				}
+				if (Plain && HighSurrogate)
+				{
+					PutUnicode(Write, HighSurrogate);
+					HighSurrogate = 0;
+				}
+				if (!InSitu) StringBuffer.append(p, Plain);
+				else
+				{
+					if (Write != p) memmove(Write, p, Plain);
+					Write += Plain;
+				}
+				it += Plain;
+
+				int ch = GetChar();
+				if (ch < 0)
+				{
+					FailChar(ch);
+					return std::string_view();
+				}
+				if (ch < 0x20)
+				{
+					Fail(JsonErrorCode::InvalidControlCharacter, Offset());
+					return std::string_view();
+				}
+
+				if (ch == '"')
+				{
+					if (HighSurrogate) PutUnicode(Write, HighSurrogate);
+					if (InSitu) return std::string_view(Start, Write - Start);
+					return StringBuffer;
+				}
+
+				int Unit = -1;
+				if (ch == '\\')
+				{
+					char Unescaped = UnescapeChar(GetChar());
+					if (!Unescaped)
+					{
+						Fail(JsonErrorCode::InvalidEscape, Offset());
+						return std::string_view();
+					}
+					if (Unescaped != 'u') ch = Unescaped;
+					else
+					{
+						Unit = ParseHex4();
+						if (Unit < 0) return std::string_view();
+						if (HighSurrogate && Unit >= 0xDC00 && Unit <= 0xDFFF)
+						{
+							PutUnicode(Write, 0x10000 + ((HighSurrogate - 0xD800) << 10) + (Unit - 0xDC00));
+							HighSurrogate = 0;
+							continue;
+						}
+					}
+				}
+
+				// A high surrogate without its low half is kept as it is
+				if (HighSurrogate)
+				{
+					PutUnicode(Write, HighSurrogate);
+					HighSurrogate = 0;
+				}
+				if (Unit >= 0xD800 && Unit <= 0xDBFF) HighSurrogate = Unit;
+				else PutUnicode(Write, Unit >= 0 ? Unit : ch);
+			}
+		}
+
+		// Appends a decoded character to StringBuffer, or at Write when parsing in situ
+		void PutUnicode(char*& Write, int Unicode)
+		{
+			if (!InSitu)
+			{
+				if (Unicode < 0x80) StringBuffer += static_cast<char>(Unicode);
+				else AppendUnicode(StringBuffer, Unicode);
+				return;
+			}
+			if (Unicode < 0x80) *Write++ = static_cast<char>(Unicode);
+			else Write += EncodeUnicode(Write, Unicode);
+		}
+
+		// When parsing in situ, has the string made next keep its characters where Value was decoded; an empty Value
+		// stops that again
+		void KeepInSitu([[maybe_unused]] std::string_view Value)
+		{
+#ifdef JSON_USE_PMR
+			if (!InSituResource) return;
+			InSituResource->Expected = const_cast<char*>(Value.data());
+			InSituResource->ExpectedBytes = Value.empty() ? 0 : Value.size() + 1;
+#endif
 		}
 
 		JsonString ParseJsonString(size_t FromLineNo, size_t FromColumn)
 		{
-			return JsonString(ParseString(), FromLineNo, FromColumn);
+			auto Value = ParseString();
+			KeepInSitu(Value);
+			auto ret = JsonString(Value, FromLineNo, FromColumn, Alloc);
+			KeepInSitu({});
+			Stats.String(ret);
+			return ret;
 		}
 
 		JsonStringPtr ParseJsonStringPtr(size_t FromLineNo, size_t FromColumn)
 		{
-			return MakeJsonStringPtr(ParseString(), FromLineNo, FromColumn);
+			auto Value = ParseString();
+			if (Failed()) return nullptr;
+			KeepInSitu(Value);
+			auto ret = AllocateJsonPtr<JsonString>(Alloc, Value, FromLineNo, FromColumn);
+			KeepInSitu({});
+			Stats.Node(JsonDataType::String);
+			Stats.String(*ret);
+			return ret;
 		}
 
 		bool SkipDigits()
 		{
-			std::string::const_iterator n;
+			std::string_view::const_iterator n = it;
 			bool SkippedDigit = false;
 			for (;;)
 			{
 				int ch = PeekChar(&n);
-				if (isdigit(ch))
+				if (ch >= '0' && ch <= '9')
 				{
 					SkippedDigit = true;
-					UpdateLineNoColumn(ch);
 					it = n;
 				}
 				else
@@ -474,44 +1306,72 @@ namespace JsonLibrary
 			return SkippedDigit;
 		}
 
-		double ParseNumber(char FirstChar)
+		// Converts a literal that is known to match the JSON number grammar
+		static bool ConvertNumber(const char* First, const char* Last, double& Value)
 		{
-			std::stringstream ss;
-			std::string::const_iterator n, si, ei;
-			ss << FirstChar;
+			auto r = std::from_chars(First, Last, Value);
+			if (r.ec == std::errc()) return true;
 
-			si = it;
+			// Out of range: let strtod() tell an underflow, which is fine, from an overflow
+			std::string Literal(First, Last);
+			Value = strtod(Literal.c_str(), nullptr);
+			return Value != HUGE_VAL && Value != -HUGE_VAL;
+		}
+
+		// Moves past the rest of a number literal whose first character was read already
+		bool SkipNumber(char FirstChar)
+		{
+			std::string_view::const_iterator n = it;
 
 			bool isMinus = (FirstChar == '-');
 			bool sd = SkipDigits();
-			if (isMinus && !sd) throw JsonDecodeError(LineNo, Column, "Expected digit");
+			if (isMinus && !sd) return Fail(JsonErrorCode::ExpectedDigit, Offset());
 
 			int next = PeekChar(&n);
 			if (next == '.')
 			{
-				UpdateLineNoColumn(next);
 				it = n;
 				sd = SkipDigits();
-				if (!sd) throw JsonDecodeError(LineNo, Column, "Expected digit");
+				if (!sd) return Fail(JsonErrorCode::ExpectedDigit, Offset());
 				next = PeekChar(&n);
 			}
 			if (next == 'e' || next == 'E')
 			{
-				UpdateLineNoColumn(next);
 				it = n;
 				next = PeekChar(&n);
-				if (next == '-')
+				if (next == '-' || next == '+')
 				{
-					UpdateLineNoColumn(next);
 					it = n;
 				}
 				sd = SkipDigits();
-				if (!sd) throw JsonDecodeError(LineNo, Column, "Expected digit");
+				if (!sd) return Fail(JsonErrorCode::ExpectedDigit, Offset());
 			}
+			return true;
+		}
 
-			ei = it;
-			for (auto i = si; i != ei; i++) ss << *i;
-			return std::stod(ss.str());
+		// The literal of a number whose first character was read already; empty on failure
+		std::string_view ParseNumberLiteral(char FirstChar)
+		{
+			size_t Start = Offset() - 1;
+			Keep = Start;
+			bool Skipped = SkipNumber(FirstChar);
+			Keep = SIZE_MAX;
+			if (!Skipped) return std::string_view();
+			return std::string_view(s.data() + (Start - Base), Offset() - Start);
+		}
+
+		double ConvertNumberLiteral(std::string_view Literal)
+		{
+			double Value;
+			if (!ConvertNumber(Literal.data(), Literal.data() + Literal.size(), Value)) return Fail(JsonErrorCode::NumberOutOfRange, Offset() - Literal.size());
+			return Value;
+		}
+
+		double ParseNumber(char FirstChar)
+		{
+			auto Literal = ParseNumberLiteral(FirstChar);
+			if (Failed()) return 0;
+			return ConvertNumberLiteral(Literal);
 		}
 
 		JsonNumber ParseJsonNumber(char FirstChar, size_t FromLineNo, size_t FromColumn)
@@ -521,320 +1381,614 @@ namespace JsonLibrary
 
 		JsonNumberPtr ParseJsonNumberUniquePtr(char FirstChar, size_t FromLineNo, size_t FromColumn)
 		{
-			return MakeJsonNumberPtr(ParseNumber(FirstChar), FromLineNo, FromColumn);
+			auto Literal = ParseNumberLiteral(FirstChar);
+			if (Failed()) return nullptr;
+			double Value = ConvertNumberLiteral(Literal);
+			if (Failed()) return nullptr;
+			Stats.Node(JsonDataType::Number);
+			if (LazyNumbers && Literal.size() <= JsonLazyNumber::MaxLiteral) return AllocateJsonPtr<JsonLazyNumber>(Alloc, Literal, Value, FromLineNo, FromColumn);
+			return AllocateJsonPtr<JsonNumber>(Alloc, Value, FromLineNo, FromColumn);
 		}
 
-		void ParseTrue()
+		// Matches the rest of true, false or null after its first character
+		bool ParseLiteral(int FirstChar, const char* Rest)
 		{
-			JsonDecodeError ex = JsonDecodeError(LineNo, Column, "Error when decoding true");
-			int r = GetChar();
-			int u = GetChar();
-			int e = GetChar();
-			if (r != 'r' || u != 'u' || e != 'e') throw ex;
+			size_t From = Offset();
+			Keep = From;
+			for (; *Rest; Rest++)
+			{
+				if (GetChar() != *Rest)
+				{
+					Keep = SIZE_MAX;
+					return Fail(JsonErrorCode::InvalidLiteral, From, FirstChar);
+				}
+			}
+			Keep = SIZE_MAX;
+			return true;
 		}
 
-		void ParseFalse()
+		bool ParseTrue()
 		{
-			JsonDecodeError ex = JsonDecodeError(LineNo, Column, "Error when decoding false");
-			int a = GetChar();
-			int l = GetChar();
-			int s = GetChar();
-			int e = GetChar();
-			if (a != 'a' || l != 'l' || s != 's' || e != 'e') throw ex;
+			return ParseLiteral('t', "rue");
 		}
 
-		void ParseNull()
+		bool ParseFalse()
 		{
-			JsonDecodeError ex = JsonDecodeError(LineNo, Column, "Error when decoding null");
-			int u = GetChar();
-			int l1 = GetChar();
-			int l2 = GetChar();
-			if (u != 'u' || l1 != 'l' || l2 != 'l') throw ex;
+			return ParseLiteral('f', "alse");
 		}
-	};
-
-	JsonData::JsonData(JsonDataType Type, size_t FromLineNo, size_t FromColumn) :
-		Type(Type),
-		LineNo(FromLineNo),
-		Column(FromColumn)
-	{
-	}
-
-	JsonDataType JsonData::GetType() const
-	{
-		return Type;
-	}
 
-	void JsonData::AddIndent(std::stringstream& ss, int indent, const std::string& indent_type)
-	{
-		for (int i = 0; i < indent; i++) ss << indent_type;
-	}
+		bool ParseNull()
+		{
+			return ParseLiteral('n', "ull");
+		}
 
-	JsonDataPtr JsonData::ParseJson(JsonParser& jp)
-	{
-		jp.SkipSpacesAndComments();
-		if (jp.End()) return nullptr;
+		enum class TypedResult { Closed, OtherKind, Failed };
 
-		size_t CurLineNo = jp.GetLineNo();
-		size_t CurColumn = jp.GetColumn();
-		int cur = jp.GetChar();
-		switch (cur)
+		// Reads the elements of an array from the first one while they are all numbers, or all booleans, into TypedValues.
+		// At an element of another kind the array goes on with nodes made of those read so far by TypedToElements().
+		TypedResult ParseTypedElements(bool Booleans)
 		{
-		case '{':
-			if (1)
+			TypedValues.clear();
+			TypedIntegers.clear();
+			TypedAllIntegers = !Booleans;
+			TypedPositions.clear();
+			for (;;)
 			{
-				jp.SkipSpacesAndComments();
-				auto ret = MakeJsonObjectPtr(CurLineNo, CurColumn);
-				if (jp.PeekChar() == '}')
+				int ch = PeekChar();
+				if (Booleans ? ch != 't' && ch != 'f' : ch != '-' && (ch < '0' || ch > '9')) return TypedResult::OtherKind;
+				if (TrackPositions)
 				{
-					jp.GetChar();
-					return ret;
+					size_t LineNo, Column;
+					GetNodePosition(LineNo, Column);
+					TypedPositions.emplace_back(LineNo, Column);
 				}
-				for (;;)
+				GetChar();
+				if (Booleans)
 				{
-					jp.SkipSpacesAndComments();
-					if (jp.GetChar() != '"') throw JsonDecodeError(jp.GetLineNo(), jp.GetColumn(), "Key name must be string");
-					auto Key = jp.ParseJsonString(jp.GetLineNo(), jp.GetColumn());
-					jp.SkipSpacesAndComments();
-					if (jp.GetChar() != ':') throw JsonDecodeError(jp.GetLineNo(), jp.GetColumn(), "No ':' found");
-					jp.SkipSpacesAndComments();
-					(*ret)[Key] = ParseJson(jp);
-					jp.SkipSpacesAndComments();
-					auto comma = jp.GetChar();
-					if (comma == '}') break;
-					if (comma == ',') continue;
-					std::stringstream ss;
-					ss << "Unexpected '" << jp.EncodeUnicode(comma) << "'";
-					throw JsonDecodeError(jp.GetLineNo(), jp.GetColumn(), ss.str());
-				}
-				return ret;
-			}
-		case '[':
-			if (1)
-			{
-				jp.SkipSpacesAndComments();
-				auto ret = MakeJsonArrayPtr(CurLineNo, CurColumn);
-				if (jp.PeekChar() == ']')
+					if (!(ch == 't' ? ParseTrue() : ParseFalse())) return TypedResult::Failed;
+					TypedValues.push_back(ch == 't');
+				}
+				else
 				{
-					jp.GetChar();
-					return ret;
+					auto Literal = ParseNumberLiteral(static_cast<char>(ch));
+					if (Failed()) return TypedResult::Failed;
+					if (TypedAllIntegers)
+					{
+						int64_t Integer;
+						auto Last = Literal.data() + Literal.size();
+						auto Converted = std::from_chars(Literal.data(), Last, Integer);
+						// -0 is a double; as an integer it would lose its sign
+						TypedAllIntegers = Converted.ec == std::errc() && Converted.ptr == Last && (Integer || Literal[0] != '-');
+						if (TypedAllIntegers) TypedIntegers.push_back(Integer);
+					}
+					double Value = ConvertNumberLiteral(Literal);
+					if (Failed()) return TypedResult::Failed;
+					TypedValues.push_back(Value);
 				}
-				for (;;)
+
+				if (!SkipSpacesAndComments()) return TypedResult::Failed;
+				int comma = GetChar();
+				if (comma == ']') return TypedResult::Closed;
+				if (comma != ',')
 				{
-					jp.SkipSpacesAndComments();
-					ret->push_back(ParseJson(jp));
-					jp.SkipSpacesAndComments();
-					auto comma = jp.GetChar();
-					if (comma == ']') break;
-					if (comma == ',') continue;
-					std::stringstream ss;
-					ss << "Unexpected '" << jp.EncodeUnicode(comma) << "'";
-					throw JsonDecodeError(jp.GetLineNo(), jp.GetColumn(), ss.str());
-				}
-				return ret;
-			}
-		case '"':
-			return jp.ParseJsonStringPtr(CurLineNo, CurColumn);
-		case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': case '-':
-			return jp.ParseJsonNumberUniquePtr(cur, CurLineNo, CurColumn);
-		case 't':
-			jp.ParseTrue();
-			return MakeJsonBooleanPtr(true, CurLineNo, CurColumn);
-		case 'f':
-			jp.ParseFalse();
-			return MakeJsonBooleanPtr(false, CurLineNo, CurColumn);
-		case 'n':
-			jp.ParseNull();
-			return MakeJsonNullPtr(CurLineNo, CurColumn);
-			break;
+					FailUnexpected(comma);
+					return TypedResult::Failed;
+				}
+				if (!SkipSpacesAndComments()) return TypedResult::Failed;
+			}
 		}
 
-		std::stringstream ss;
-		ss << "Unexpected '" << jp.EncodeUnicode(cur) << "'";
-		throw JsonDecodeError(CurLineNo, CurColumn, ss.str());
-		return nullptr;
-	}
-
-	static std::string EscapeToUxxxx(int CodePoint)
-	{
-		std::stringstream ss;
-		if (CodePoint < 0)
+		void TypedToElements(bool Booleans)
 		{
-			ss << "can't encode 0x" << std::hex << static_cast<uint32_t>(CodePoint) << ": invalid code point";
-			throw UnicodeEncodeError(ss.str());
+			for (size_t i = 0; i < TypedValues.size(); i++)
+			{
+				auto Position = TrackPositions ? TypedPositions[i] : std::pair<size_t, size_t>();
+				if (Booleans)
+				{
+					Stats.Node(JsonDataType::Boolean);
+					Elements.push_back(AllocateJsonPtr<JsonBoolean>(Alloc, TypedValues[i] != 0, Position.first, Position.second));
+				}
+				else
+				{
+					Stats.Node(JsonDataType::Number);
+					Elements.push_back(AllocateJsonPtr<JsonNumber>(Alloc, TypedValues[i], Position.first, Position.second));
+				}
+			}
 		}
-		if (CodePoint > 0x10000)
+
+		// Moves past the rest of a string whose opening quote was read already, checking it like ParseString() does
+		bool SkipString()
 		{
-			// Process UTF-16 surrogate pair
-			int first = CodePoint >> 10;
-			int second = CodePoint & 0x3F;
-			ss << "\\u" << EscapeToUxxxx(0xD800 | first);
-			ss << "\\u" << EscapeToUxxxx(0xDC00 | second);
+			for (;;)
+			{
+				// Plain ASCII and well-formed UTF-8 need no decoding
+				it += CountStringBytes(s.data() + (it - s.cbegin()), static_cast<size_t>(s.cend() - it));
+
+				int ch = GetChar();
+				if (ch < 0) return FailChar(ch);
+				if (ch < 0x20) return Fail(JsonErrorCode::InvalidControlCharacter, Offset());
+				if (ch == '"') return true;
+				if (ch != '\\') continue;
+
+				char Unescaped = UnescapeChar(GetChar());
+				if (!Unescaped) return Fail(JsonErrorCode::InvalidEscape, Offset());
+				if (Unescaped == 'u' && ParseHex4() < 0) return false;
+			}
 		}
-		else
+
+		// Records a value the handler of Scan() refused
+		template<typename Handler>
+		bool FailHandler(const Handler& h, size_t At)
 		{
-			ss << "\\u" << Hex4(CodePoint);
+			return Fail(JsonErrorCode::SchemaViolation, At, h.GetFailure());
 		}
-		return ss.str();
-	}
-
-	static std::string EscapeJsonString(const std::string& s)
-	{
-		std::stringstream ss;
-
-		Utf8Parser jp(s);
 
-		while (!jp.End())
+		// Reads an object key and the ':' after it
+		template<typename Handler>
+		bool ScanKey(Handler& h)
 		{
-			int ch = jp.GetChar();
-			if (ch < 0x20)
+			if (!SkipSpacesAndComments()) return false;
+			size_t KeyOffset = Offset();
+			int quote = GetChar();
+			if (quote != '"')
 			{
-				switch (ch)
-				{
-				case '\b': ss << "\\b"; break;
-				case '\f': ss << "\\f"; break;
-				case '\n': ss << "\\n"; break;
-				case '\r': ss << "\\r"; break;
-				case '\t': ss << "\\t"; break;
-				default:
-					ss << EscapeToUxxxx(ch);
-					break;
-				}
+				if (quote < 0) return FailChar(quote);
+				return Fail(JsonErrorCode::KeyMustBeString, Offset());
 			}
-			else if (ch >= 0x7f)
+			if constexpr (Handler::WantsValues)
 			{
-				ss << EscapeToUxxxx(ch);
+				auto Key = ParseString();
+				if (Failed()) return false;
+				if (!h.Key(Key)) return FailHandler(h, KeyOffset);
 			}
-			else
+			else if (!SkipString()) return false;
+			if (!SkipSpacesAndComments()) return false;
+			int colon = GetChar();
+			if (colon != ':')
 			{
-				ss << Utf8Parser::EncodeUnicode(ch);
+				if (colon < 0) return FailChar(colon);
+				return Fail(JsonErrorCode::ExpectedColon, Offset());
 			}
+			return true;
 		}
-		return ss.str();
-	}
-
-	JsonObject::JsonObject(size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Object, FromLineNo, FromColumn)
-	{
-	}
 
-	JsonObject::JsonObject(const JsonObjectParentType& c, size_t FromLineNo, size_t FromColumn) :
-		JsonObjectParentType(c),
-		JsonData(JsonDataType::Object, FromLineNo, FromColumn)
-	{
-	}
+		// Checks one value against the grammar of ParseJson() without building anything, reporting what it reads to the handler.
+		// Unless the handler wants the values, strings are not decoded and numbers not converted.
+		// Open containers are kept on a bit stack, 1 for an object and 0 for an array.
+		// Opened is the bracket of a container that was read already, to check the rest of it.
+		template<typename Handler>
+		bool Scan(Handler& h, size_t MaxDepth, int Opened = 0)
+		{
+			uint64_t Stack[JsonMaxValidateDepth / 64];
+			size_t Depth = 0;
+			if (MaxDepth > JsonMaxValidateDepth) MaxDepth = JsonMaxValidateDepth;
 
-	std::string JsonObject::ToString(int indent, int cur_indent, const std::string& indent_type) const
-	{
-		std::stringstream ss;
-		ss << "{";
-		if (indent) ss << std::endl;
-		cur_indent += indent;
-		for (auto it = cbegin(); it != cend();)
-		{
-			AddIndent(ss, cur_indent, indent_type);
-			ss << "\"" << EscapeJsonString(it->first) << "\":";
-			if (indent) ss << " ";
-			ss << it->second->ToString(indent, cur_indent, indent_type);
-			it++;
-			if (it != cend()) ss << ",";
-			if (indent) ss << std::endl;
-		}
-		cur_indent -= indent;
-		AddIndent(ss, cur_indent, indent_type);
-		ss << "}";
-		return ss.str();
-	}
+			for (;;)
+			{
+				// One value, or the start of a container
+				if (!Opened && !SkipSpacesAndComments()) return false;
+				size_t CurOffset = Opened ? Offset() - 1 : Offset();
+				int cur = Opened ? Opened : GetChar();
+				Opened = 0;
+				bool Closed = true;
+				switch (cur)
+				{
+				case '{':
+				case '[':
+					if (1)
+					{
+						if (Depth >= MaxDepth) return Fail(JsonErrorCode::TooDeep, CurOffset);
+						if (!(cur == '{' ? h.StartObject() : h.StartArray())) return FailHandler(h, CurOffset);
+						uint64_t Bit = uint64_t(1) << (Depth % 64);
+						if (cur == '{') Stack[Depth / 64] |= Bit;
+						else Stack[Depth / 64] &= ~Bit;
+						Depth++;
+						if (!SkipSpacesAndComments()) return false;
+						int Close = cur == '{' ? '}' : ']';
+						size_t CloseOffset = Offset();
+						if (PeekChar() == Close)
+						{
+							GetChar();
+							Depth--;
+							if (!(cur == '{' ? h.EndObject() : h.EndArray())) return FailHandler(h, CloseOffset);
+						}
+						else
+						{
+							if (cur == '{' && !ScanKey(h)) return false;
+							Closed = false;
+						}
+					}
+					break;
+				case '"':
+					if constexpr (Handler::WantsValues)
+					{
+						auto Value = ParseString();
+						if (Failed()) return false;
+						if (!h.String(Value)) return FailHandler(h, CurOffset);
+					}
+					else if (!SkipString()) return false;
+					break;
+				case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': case '-':
+					if constexpr (Handler::WantsValues)
+					{
+						double Value = ParseNumber(static_cast<char>(cur));
+						if (Failed()) return false;
+						if (!h.Number(Value)) return FailHandler(h, CurOffset);
+					}
+					else if constexpr (Handler::ChecksRange)
+					{
+						// Without an exponent it takes over 300 digits to leave the range of a double
+						auto Literal = ParseNumberLiteral(static_cast<char>(cur));
+						if (Failed()) return false;
+						if (Literal.size() > 300 || Literal.find_first_of("eE") != std::string_view::npos)
+						{
+							ConvertNumberLiteral(Literal);
+							if (Failed()) return false;
+						}
+					}
+					else if (!SkipNumber(static_cast<char>(cur))) return false;
+					break;
+				case 't':
+					if (!ParseTrue()) return false;
+					if (!h.Boolean(true)) return FailHandler(h, CurOffset);
+					break;
+				case 'f':
+					if (!ParseFalse()) return false;
+					if (!h.Boolean(false)) return FailHandler(h, CurOffset);
+					break;
+				case 'n':
+					if (!ParseNull()) return false;
+					if (!h.Null()) return FailHandler(h, CurOffset);
+					break;
+				default:
+					if (cur < 0) return FailChar(cur);
+					return Fail(JsonErrorCode::UnexpectedCharacter, CurOffset, cur);
+				}
+				if (!Closed) continue;
 
-	JsonArray::JsonArray(size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Array, FromLineNo, FromColumn)
-	{
-	}
+				// After a value: a ',' leads to the next one, a closing bracket finishes the container
+				for (;;)
+				{
+					if (!Depth) return true;
+					bool IsObject = (Stack[(Depth - 1) / 64] >> ((Depth - 1) % 64)) & 1;
+					if (!SkipSpacesAndComments()) return false;
+					size_t CommaOffset = Offset();
+					int comma = GetChar();
+					if (comma == ',')
+					{
+						if (IsObject && !ScanKey(h)) return false;
+						break;
+					}
+					if (comma != (IsObject ? '}' : ']')) return FailUnexpected(comma);
+					Depth--;
+					if (!(IsObject ? h.EndObject() : h.EndArray())) return FailHandler(h, CommaOffset);
+				}
+			}
+		}
+	};
 
-	JsonArray::JsonArray(const JsonArrayParentType& c, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Array, FromLineNo, FromColumn),
-		JsonArrayParentType(c)
-	{
-	}
+	// Set while ToStringSpliced() runs
+	static thread_local bool SpliceSource = false;
 
-	std::string JsonArray::ToString(int indent, int cur_indent, const std::string& indent_type) const
+	class SpliceScope
 	{
-		std::stringstream ss;
-		ss << "[";
-		if (indent) ss << std::endl;
-		cur_indent += indent;
-		for (size_t i = 0; i < size();)
-		{
-			AddIndent(ss, cur_indent, indent_type);
-			ss << JsonArrayParentType::operator[](i)->ToString(indent, cur_indent, indent_type);
-			i++;
-			if (i < size()) ss << ",";
-			if (indent) ss << std::endl;
-		}
-		cur_indent -= indent;
-		AddIndent(ss, cur_indent, indent_type);
-		ss << "]";
-		return ss.str();
-	}
+	protected:
+		bool Saved;
 
-	JsonString::JsonString(size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::String, FromLineNo, FromColumn)
-	{
-	}
+	public:
+		SpliceScope() : Saved(SpliceSource) { SpliceSource = true; }
+		~SpliceScope() { SpliceSource = Saved; }
+	};
 
-	JsonString::JsonString(const std::string& Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::String, FromLineNo, FromColumn),
-		std::string(Value)
+	// Set while a JsonUtf8OutputScope is alive
+	static thread_local bool Utf8Output = false;
+
+	JsonUtf8OutputScope::JsonUtf8OutputScope(bool Enable) :
+		Saved(Utf8Output)
 	{
+		Utf8Output = Enable;
 	}
 
-	std::string JsonString::ToString(int indent, int cur_indent, const std::string& indent_type) const
+	JsonUtf8OutputScope::~JsonUtf8OutputScope()
 	{
-		std::stringstream ss;
-		ss << "\"" << EscapeJsonString(*this) << "\"";
-		return ss.str();
+		Utf8Output = Saved;
 	}
 
-	JsonNumber::JsonNumber(size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
-		Value(0)
+	JsonData::JsonData(JsonDataType Type, size_t FromLineNo, size_t FromColumn) :
+		Type(Type),
+		LineNo(static_cast<uint32_t>(std::min<size_t>(FromLineNo, UINT32_MAX))),
+		Column(static_cast<uint32_t>(std::min<size_t>(FromColumn, UINT32_MAX))),
+		Extended(false)
 	{
 	}
 
-	JsonNumber::JsonNumber(std::int32_t Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
-		Value(static_cast<double>(Value))
+	JsonDataType JsonData::GetType() const
 	{
+		return Type;
 	}
-	JsonNumber::JsonNumber(std::int64_t Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
-		Value(static_cast<double>(Value))
+
+	// Reads the name and colon of the next member of the object on top of jp.Frames, and makes room for its value
+	static bool ParseMemberName(JsonParser& jp)
 	{
+		if (!jp.SkipSpacesAndComments()) return false;
+		int quote = jp.GetChar();
+		if (quote != '"')
+		{
+			if (quote < 0) return jp.FailChar(quote);
+			return jp.Fail(JsonErrorCode::KeyMustBeString, jp.Offset());
+		}
+		size_t KeyLineNo, KeyColumn;
+		jp.GetNodePosition(KeyLineNo, KeyColumn);
+		auto Key = jp.ParseJsonString(KeyLineNo, KeyColumn);
+		if (jp.Failed() || !jp.SkipSpacesAndComments()) return false;
+		int colon = jp.GetChar();
+		if (colon != ':')
+		{
+			if (colon < 0) return jp.FailChar(colon);
+			return jp.Fail(JsonErrorCode::ExpectedColon, jp.Offset());
+		}
+		jp.Stats.Member();
+
+		// A repeated name keeps its place and takes the later value
+		auto& Frame = jp.Frames.back();
+		Frame.Member = Frame.Object->try_emplace(std::move(Key)).first;
+		return true;
 	}
-	JsonNumber::JsonNumber(std::uint32_t Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
-		Value(static_cast<double>(Value))
+
+	// The open objects and arrays are kept on jp.Frames rather than the call stack, so the depth is only limited by jp.MaxDepth
+	JsonDataPtr JsonData::ParseJson(JsonParser& jp)
 	{
+		size_t Bottom = jp.Frames.size();
+		JsonDataPtr Value;
+
+		// With RetainSource the containers are JsonSourceObjects and JsonSourceArrays
+		auto KeepSpan = [&jp](JsonParser::Frame& Frame, size_t Begin)
+		{
+			if (!jp.Source) return;
+			if (Frame.Object) static_cast<JsonSourceObject*>(Frame.Object)->SourceSpan = jp.SourceSpan(Begin);
+			else static_cast<JsonSourceArray*>(Frame.Array)->SourceSpan = jp.SourceSpan(Begin);
+		};
+
+		for (;;)
+		{
+			// One value, or the start of a container
+			if (!jp.SkipSpacesAndComments()) return nullptr;
+
+			size_t CurLineNo, CurColumn;
+			size_t CurOffset = jp.Offset();
+			jp.GetNodePosition(CurLineNo, CurColumn);
+			int cur = jp.GetChar();
+			switch (cur)
+			{
+			case '{':
+			case '[':
+				{
+					if (jp.Frames.size() - Bottom >= jp.MaxDepth)
+					{
+						jp.Fail(JsonErrorCode::TooDeep, CurOffset);
+						return nullptr;
+					}
+					if (jp.Frames.size() - Bottom >= jp.LazyDepth)
+					{
+						// Only checked here; its members are parsed from its span when first accessed
+						JsonLazyHandler Check;
+						if (!jp.Scan(Check, jp.MaxDepth - (jp.Frames.size() - Bottom), cur)) return nullptr;
+						if (cur == '{')
+						{
+							auto Object = AllocateJsonPtr<JsonSourceObject>(jp.Alloc, CurLineNo, CurColumn);
+							jp.Stats.Node(JsonDataType::Object);
+							Object->SourceSpan = JsonSourceSpan(jp.LazyText, CurOffset, jp.Offset());
+							Object->Lazy.Set(jp.LazyFlags());
+							Value = std::move(Object);
+						}
+						else
+						{
+							auto Array = AllocateJsonPtr<JsonSourceArray>(jp.Alloc, CurLineNo, CurColumn);
+							jp.Stats.Node(JsonDataType::Array);
+							Array->SourceSpan = JsonSourceSpan(jp.LazyText, CurOffset, jp.Offset());
+							Array->Lazy.Set(jp.LazyFlags());
+							Value = std::move(Array);
+						}
+						break;
+					}
+					if (!jp.SkipSpacesAndComments()) return nullptr;
+					size_t FirstElement = jp.Elements.size();
+
+					// An array that turns out typed is made after its elements, as a JsonSourceArray holding them
+					if (cur == '[' && jp.TypedArrays && !jp.LazyNumbers)
+					{
+						int First = jp.PeekChar();
+						bool Booleans = First == 't' || First == 'f';
+						if (Booleans || First == '-' || (First >= '0' && First <= '9'))
+						{
+							jp.Stats.Enter();
+							auto Typed = jp.ParseTypedElements(Booleans);
+							if (Typed == JsonParser::TypedResult::Failed) return nullptr;
+							if (Typed == JsonParser::TypedResult::Closed)
+							{
+								jp.Stats.Leave();
+								jp.Stats.Node(JsonDataType::Array);
+								auto Array = AllocateJsonPtr<JsonSourceArray>(jp.Alloc, CurLineNo, CurColumn);
+								Array->TypedElements.store(jp.TypedAllIntegers ?
+									AllocateJsonPtr<JsonTypedElements>(jp.Alloc, jp.TypedIntegers.data(), jp.TypedIntegers.data() + jp.TypedIntegers.size(), jp.Alloc) :
+									AllocateJsonPtr<JsonTypedElements>(jp.Alloc, jp.TypedValues.data(), jp.TypedValues.data() + jp.TypedValues.size(), Booleans, jp.Alloc));
+								Array->Lazy.Set(JsonLazyContent::Pending | JsonLazyContent::Typed);
+								Array->SourceSpan = jp.SourceSpan(CurOffset);
+								Value = std::move(Array);
+								break;
+							}
+							jp.Stats.Leave();
+							jp.TypedToElements(Booleans);
+						}
+					}
+
+					JsonParser::Frame Frame{};
+					if (cur == '{')
+					{
+						auto Object = jp.Source ? AllocateJsonPtr<JsonSourceObject>(jp.Alloc, CurLineNo, CurColumn) : AllocateJsonPtr<JsonObject>(jp.Alloc, CurLineNo, CurColumn);
+						jp.Stats.Node(JsonDataType::Object);
+						Frame.Object = Object.get();
+						Frame.Container = std::move(Object);
+					}
+					else
+					{
+						auto Array = jp.Source ? AllocateJsonPtr<JsonSourceArray>(jp.Alloc, CurLineNo, CurColumn) : AllocateJsonPtr<JsonArray>(jp.Alloc, CurLineNo, CurColumn);
+						jp.Stats.Node(JsonDataType::Array);
+						Frame.Array = Array.get();
+						Frame.Container = std::move(Array);
+					}
+					jp.Stats.Enter();
+					if (jp.PeekChar() == (cur == '{' ? '}' : ']'))
+					{
+						jp.GetChar();
+						jp.Stats.Leave();
+						KeepSpan(Frame, CurOffset);
+						Value = std::move(Frame.Container);
+						break;
+					}
+					Frame.Offset = CurOffset;
+					Frame.First = FirstElement;
+					jp.Frames.push_back(std::move(Frame));
+					if (cur == '{' && !ParseMemberName(jp)) return nullptr;
+					continue;
+				}
+			case '"':
+				Value = jp.ParseJsonStringPtr(CurLineNo, CurColumn);
+				if (!Value) return nullptr;
+				break;
+			case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': case '-':
+				Value = jp.ParseJsonNumberUniquePtr(cur, CurLineNo, CurColumn);
+				if (!Value) return nullptr;
+				break;
+			case 't':
+				if (!jp.ParseTrue()) return nullptr;
+				jp.Stats.Node(JsonDataType::Boolean);
+				Value = AllocateJsonPtr<JsonBoolean>(jp.Alloc, true, CurLineNo, CurColumn);
+				break;
+			case 'f':
+				if (!jp.ParseFalse()) return nullptr;
+				jp.Stats.Node(JsonDataType::Boolean);
+				Value = AllocateJsonPtr<JsonBoolean>(jp.Alloc, false, CurLineNo, CurColumn);
+				break;
+			case 'n':
+				if (!jp.ParseNull()) return nullptr;
+				jp.Stats.Node(JsonDataType::Null);
+				Value = AllocateJsonPtr<JsonNull>(jp.Alloc, CurLineNo, CurColumn);
+				break;
+			default:
+				if (cur < 0) jp.FailChar(cur);
+				else jp.Fail(JsonErrorCode::UnexpectedCharacter, CurOffset, cur);
+				return nullptr;
+			}
+
+			// A value is complete: it goes into the container on top, and closes each container that ends after it
+			for (;;)
+			{
+				if (jp.Frames.size() == Bottom) return Value;
+				auto& Frame = jp.Frames.back();
+				if (Frame.Object) Frame.Member->second = std::move(Value);
+				else jp.Elements.push_back(std::move(Value));
+
+				if (!jp.SkipSpacesAndComments()) return nullptr;
+				int comma = jp.GetChar();
+				if (comma == ',')
+				{
+					if (Frame.Object && !ParseMemberName(jp)) return nullptr;
+					break;
+				}
+				if (comma != (Frame.Object ? '}' : ']'))
+				{
+					jp.FailUnexpected(comma);
+					return nullptr;
+				}
+
+				if (Frame.Array)
+				{
+					jp.Stats.ArrayGrowth(*Frame.Array);
+					Frame.Array->assign(std::make_move_iterator(jp.Elements.begin() + Frame.First), std::make_move_iterator(jp.Elements.end()));
+					jp.Elements.resize(Frame.First);
+				}
+				KeepSpan(Frame, Frame.Offset);
+				jp.Stats.Leave();
+				Value = std::move(Frame.Container);
+				jp.Frames.pop_back();
+			}
+		}
 	}
-	JsonNumber::JsonNumber(std::uint64_t Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
-		Value(static_cast<double>(Value))
+
+	static void AppendUxxxx(std::string& Out, int Unit)
 	{
+		static const char Digits[] = "0123456789ABCDEF";
+		char buf[6] = { '\\', 'u', Digits[(Unit >> 12) & 0xF], Digits[(Unit >> 8) & 0xF], Digits[(Unit >> 4) & 0xF], Digits[Unit & 0xF] };
+		Out.append(buf, sizeof buf);
 	}
-	JsonNumber::JsonNumber(float Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
-		Value(static_cast<double>(Value))
+
+	static void EscapeToUxxxx(std::string& Out, int CodePoint)
 	{
+		if (CodePoint < 0 || CodePoint > 0x10FFFF)
+		{
+			std::stringstream ss;
+			ss << "can't encode 0x" << std::hex << static_cast<uint32_t>(CodePoint) << ": invalid code point";
+			throw UnicodeEncodeError(ss.str());
+		}
+		if (CodePoint >= 0x10000)
+		{
+			// Process UTF-16 surrogate pair
+			CodePoint -= 0x10000;
+			AppendUxxxx(Out, 0xD800 | (CodePoint >> 10));
+			AppendUxxxx(Out, 0xDC00 | (CodePoint & 0x3FF));
+		}
+		else
+		{
+			AppendUxxxx(Out, CodePoint);
+		}
 	}
-	JsonNumber::JsonNumber(double Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
-		Value(Value)
+
+	// Appends s escaped for a JSON string literal; runs of plain characters are copied as they are
+	static void EscapeJsonString(std::string& Out, std::string_view s)
 	{
+		bool Utf8 = Utf8Output;
+		Utf8Parser jp(s);
+		size_t i = 0;
+		while (i < s.size())
+		{
+			size_t Plain = CountPlainBytes(s.data() + i, s.size() - i, true);
+			Out.append(s.data() + i, Plain);
+			i += Plain;
+			jp.Skip(Plain);
+			if (i == s.size()) break;
+
+			uint8_t b = static_cast<uint8_t>(s[i]);
+			if (b < 0x80)
+			{
+				i++;
+				jp.Skip(1);
+				switch (b)
+				{
+				case '"': Out += "\\\""; break;
+				case '\\': Out += "\\\\"; break;
+				case '\b': Out += "\\b"; break;
+				case '\f': Out += "\\f"; break;
+				case '\n': Out += "\\n"; break;
+				case '\r': Out += "\\r"; break;
+				case '\t': Out += "\\t"; break;
+				default: AppendUxxxx(Out, b); break;
+				}
+				continue;
+			}
+
+			int ch = jp.GetChar();
+			if (ch < 0) throw UnicodeDecodeError(jp.GetLineNo(), jp.GetColumn(), Utf8ErrorMessage(b, ch == Utf8Parser::TruncatedUtf8));
+			size_t Next = jp.Offset();
+			if (Utf8 && ch <= 0x10FFFF) Out.append(s.data() + i, Next - i);
+			else EscapeToUxxxx(Out, ch);
+			i = Next;
+		}
 	}
 
-	std::string JsonNumber::ToString(int indent, int cur_indent, const std::string& indent_type) const
+	// What ToString() gives for a number without a literal, also written for the elements of typed arrays
+	static std::string_view FormatNumber(char (&buf)[256], double Value)
 	{
-		char buf[256];
 		char* chr = buf;
 		char* chw = buf;
 		char* pt = nullptr;
@@ -866,520 +2020,4141 @@ namespace JsonLibrary
 		return buf;
 	}
 
-	JsonBoolean::JsonBoolean(size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Boolean, FromLineNo, FromColumn),
-		Value(0)
+	// An element of a typed array as its node would write it, integers with all their digits
+	static std::string_view FormatTypedElement(char (&buf)[256], const JsonTypedElements& Typed, size_t Index)
 	{
+		switch (Typed.GetElementType())
+		{
+		case JsonTypedElements::ElementType::Boolean:
+			return Typed.GetBoolean(Index) ? "true" : "false";
+		case JsonTypedElements::ElementType::Integer:
+			return std::string_view(buf, std::to_chars(buf, buf + sizeof buf, Typed.GetInteger(Index)).ptr);
+		default:
+			return FormatNumber(buf, Typed.GetNumber(Index));
+		}
 	}
 
-	JsonBoolean::JsonBoolean(bool Value, size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Boolean, FromLineNo, FromColumn),
-		Value(Value)
+	// Writes what ToString() returns for Json to Out, a std::string or anything with Write(std::string_view).
+	// The open objects and arrays are kept on a stack of its own, so deep documents don't recurse.
+	template<typename Output>
+	static void SerializeJson(Output& Out, const JsonData& Json, int indent, int cur_indent, const std::string& indent_type)
 	{
-	}
+		std::string Quoted;
+		auto Put = [&](std::string_view s)
+		{
+			if constexpr (std::is_same_v<Output, std::string>) Out += s;
+			else Out.Write(s);
+		};
+		auto PutQuoted = [&](std::string_view s)
+		{
+			if constexpr (std::is_same_v<Output, std::string>)
+			{
+				Out += '"';
+				EscapeJsonString(Out, s);
+				Out += '"';
+			}
+			else
+			{
+				Quoted.clear();
+				Quoted += '"';
+				EscapeJsonString(Quoted, s);
+				Quoted += '"';
+				Out.Write(Quoted);
+			}
+		};
+		auto PutIndent = [&](int Count)
+		{
+			for (int i = 0; i < Count; i++) Put(indent_type);
+		};
 
-	std::string JsonBoolean::ToString(int indent, int cur_indent, const std::string& indent_type) const
-	{
-		if (Value) return "true";
-		else return "false";
-	}
+		struct Frame
+		{
+			const JsonObject* Object;
+			const JsonArray* Array;
+			JsonObject::const_iterator Member;
+			size_t Index;
+		};
+		std::vector<Frame> Stack;
+
+		// Writes a value whole, or the opening of an object or array and pushes it
+		auto Open = [&](const JsonData& Value)
+		{
+			switch (Value.GetType())
+			{
+			case JsonDataType::Object:
+				{
+					auto& Object = static_cast<const JsonObject&>(Value);
+					if (SpliceSource && Object.GetSourceSpan()) return Put(Object.GetSourceSpan().View());
+					Put(indent ? "{\n" : "{");
+					cur_indent += indent;
+					Stack.push_back(Frame{&Object, nullptr, Object.cbegin(), 0});
+					return;
+				}
+			case JsonDataType::Array:
+				{
+					auto& Array = static_cast<const JsonArray&>(Value);
+					if (SpliceSource && Array.GetSourceSpan()) return Put(Array.GetSourceSpan().View());
+					Put(indent ? "[\n" : "[");
+					cur_indent += indent;
+					if (auto Typed = Array.ShareTypedElements())
+					{
+						// Written from the buffer, without making the nodes
+						char buf[256];
+						for (size_t i = 0; i < Typed->size(); i++)
+						{
+							if (i) Put(indent ? ",\n" : ",");
+							PutIndent(cur_indent);
+							Put(FormatTypedElement(buf, *Typed, i));
+						}
+						if (indent) Put("\n");
+						cur_indent -= indent;
+						PutIndent(cur_indent);
+						return Put("]");
+					}
+					Stack.push_back(Frame{nullptr, &Array, JsonObject::const_iterator(), 0});
+					return;
+				}
+			case JsonDataType::String:
+				return PutQuoted(static_cast<const JsonString&>(Value));
+			default:
+				return Put(Value.ToString(indent, cur_indent, indent_type));
+			}
+		};
 
-	JsonNull::JsonNull(size_t FromLineNo, size_t FromColumn) :
-		JsonData(JsonDataType::Null, FromLineNo, FromColumn)
-	{
-	}
+		Open(Json);
+		while (!Stack.empty())
+		{
+			auto& Top = Stack.back();
+			bool First = Top.Object ? Top.Member == Top.Object->cbegin() : Top.Index == 0;
+			bool More = Top.Object ? Top.Member != Top.Object->cend() : Top.Index < Top.Array->size();
+			if (!More)
+			{
+				if (!First && indent) Put("\n");
+				cur_indent -= indent;
+				PutIndent(cur_indent);
+				Put(Top.Object ? "}" : "]");
+				Stack.pop_back();
+				continue;
+			}
 
-	std::string JsonNull::ToString(int indent, int cur_indent, const std::string& indent_type) const
-	{
-		return "null";
+			if (!First) Put(indent ? ",\n" : ",");
+			PutIndent(cur_indent);
+			const JsonData* Child;
+			if (Top.Object)
+			{
+				PutQuoted(Top.Member->first);
+				Put(indent ? ": " : ":");
+				Child = Top.Member->second.get();
+				++Top.Member;
+			}
+			else Child = Top.Array->cbegin()[Top.Index++].get();
+			Open(*Child);
+		}
 	}
 
-	size_t JsonData::GetLineNo() const
+	JsonObject::JsonObject(size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Object, FromLineNo, FromColumn)
 	{
-		return LineNo;
 	}
 
-	size_t JsonData::GetColumn() const
+	JsonObject::JsonObject(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc) :
+		JsonData(JsonDataType::Object, FromLineNo, FromColumn),
+		JsonObjectParentType(Alloc)
 	{
-		return Column;
 	}
 
-	JsonObject& JsonData::AsJsonObject()
+	JsonObject::JsonObject(const JsonAllocatorType& Alloc) :
+		JsonData(JsonDataType::Object, 0, 0),
+		JsonObjectParentType(Alloc)
 	{
-		auto p = dynamic_cast<JsonObject*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	JsonArray& JsonData::AsJsonArray()
+	JsonObject::JsonObject(const JsonData& Position, const JsonAllocatorType& Alloc) :
+		JsonData(Position),
+		JsonObjectParentType(Alloc)
 	{
-		auto p = dynamic_cast<JsonArray*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	JsonString& JsonData::AsJsonString()
+	JsonObject::JsonObject(const JsonObject& c) :
+		JsonData(c),
+		JsonObjectParentType(Loaded(c))
 	{
-		auto p = dynamic_cast<JsonString*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON string, got a JSON ") + JsonDataTypeToString(Type));
+		Extended = false;
 	}
 
-	JsonNumber& JsonData::AsJsonNumber()
+	JsonObject::JsonObject(const JsonObject& c, const JsonAllocatorType& Alloc) :
+		JsonData(c),
+		JsonObjectParentType(Loaded(c), Alloc)
 	{
-		auto p = dynamic_cast<JsonNumber*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+		Extended = false;
 	}
 
-	JsonBoolean& JsonData::AsJsonBoolean()
+	JsonSourceObject::JsonSourceObject(size_t FromLineNo, size_t FromColumn) :
+		JsonObject(FromLineNo, FromColumn)
 	{
-		auto p = dynamic_cast<JsonBoolean*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON boolean, got a JSON ") + JsonDataTypeToString(Type));
+		Extended = true;
 	}
 
-	const JsonObject& JsonData::AsJsonObject() const
+	JsonSourceObject::JsonSourceObject(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc) :
+		JsonObject(FromLineNo, FromColumn, Alloc)
 	{
-		auto p = dynamic_cast<const JsonObject*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+		Extended = true;
 	}
 
-	const JsonArray& JsonData::AsJsonArray() const
+	// A copy of an object whose members are still deferred parses them itself, from the same span
+	JsonSourceObject::JsonSourceObject(const JsonSourceObject& c) :
+		JsonObject(static_cast<const JsonData&>(c), JsonAllocatorType(c.get_allocator())),
+		SourceSpan(c.SourceSpan)
 	{
-		auto p = dynamic_cast<const JsonArray*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		uint8_t Flags = c.Lazy.Get() & ~JsonLazyContent::Loading;
+		if (Flags & JsonLazyContent::Pending) Lazy.Set(Flags);
+		else JsonObjectParentType::operator =(Loaded(c));
 	}
 
-	const JsonString& JsonData::AsJsonString() const
+	JsonObject::JsonObject(const JsonObjectParentType& c, size_t FromLineNo, size_t FromColumn) :
+		JsonObjectParentType(c),
+		JsonData(JsonDataType::Object, FromLineNo, FromColumn)
 	{
-		auto p = dynamic_cast<const JsonString*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON string, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	const JsonNumber& JsonData::AsJsonNumber() const
+	// Destroying a tree recurses through the destructors of its children, which is left alone for the first MaxReleaseDepth levels.
+	// A container deeper than that releases what is below it from a list instead: the children of every container
+	// about to go away are moved to the list before it is destroyed. Children still referenced elsewhere are only released.
+	static thread_local size_t ReleaseDepth = 0;
+	constexpr size_t MaxReleaseDepth = 64;
+
+	// An object or array with children that only this reference keeps alive
+	static bool OwnsChildren(const JsonDataPtr& Child)
 	{
-		auto p = dynamic_cast<const JsonNumber*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+		if (!Child || Child.use_count() != 1) return false;
+		switch (Child->GetType())
+		{
+		case JsonDataType::Object: return !static_cast<const JsonObjectParentType&>(static_cast<const JsonObject&>(*Child)).empty();
+		case JsonDataType::Array: return !static_cast<const JsonArrayParentType&>(static_cast<const JsonArray&>(*Child)).empty();
+		default: return false;
+		}
 	}
 
-	const JsonBoolean& JsonData::AsJsonBoolean() const
+	static void TakeChildren(JsonData& Json, std::vector<JsonDataPtr>& Pending)
 	{
-		auto p = dynamic_cast<const JsonBoolean*>(this);
-		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON boolean, got a JSON ") + JsonDataTypeToString(Type));
+		if (Json.GetType() == JsonDataType::Object)
+		{
+			auto& Object = static_cast<JsonObjectParentType&>(static_cast<JsonObject&>(Json));
+			for (auto& Member : Object)
+			{
+				if (Member.second) Pending.push_back(std::move(Member.second));
+			}
+		}
+		else if (Json.GetType() == JsonDataType::Array)
+		{
+			auto& Array = static_cast<JsonArrayParentType&>(static_cast<JsonArray&>(Json));
+			for (auto& Element : Array)
+			{
+				if (Element) Pending.push_back(std::move(Element));
+			}
+		}
 	}
 
-	bool JsonData::IsNull() const
+	static void ReleaseTree(JsonData& Json)
 	{
-		auto p = dynamic_cast<const JsonNull*>(this);
-		return p ? true : false;
+		std::vector<JsonDataPtr> Pending;
+		TakeChildren(Json, Pending);
+		while (!Pending.empty())
+		{
+			auto Node = std::move(Pending.back());
+			Pending.pop_back();
+			if (OwnsChildren(Node)) TakeChildren(*Node, Pending);
+		}
 	}
 
-	JsonDataPtr JsonData::ParseJson(const std::string& s)
+	JsonObject::~JsonObject()
 	{
-		JsonParser jp(s);
-		auto ret = ParseJson(jp);
-		jp.SkipSpacesAndComments();
-		if (!jp.End()) throw JsonDecodeError(jp.GetLineNo(), jp.GetColumn(), "Unexpected extra data");
-		return ret;
+		if (ReleaseDepth >= MaxReleaseDepth) ReleaseTree(*this);
+		else
+		{
+			ReleaseDepth++;
+			JsonObjectParentType::clear();
+			ReleaseDepth--;
+		}
 	}
 
-	bool JsonData::operator ==(const JsonData& c) const
+	JsonArray::~JsonArray()
 	{
-		if (Type != c.Type) return false;
-		switch (c.GetType())
+		if (ReleaseDepth >= MaxReleaseDepth) ReleaseTree(*this);
+		else
 		{
-		case JsonDataType::Object:
-			return AsJsonObject() == c.AsJsonObject();
-		case JsonDataType::Array:
-			return AsJsonArray() == c.AsJsonArray();
-		case JsonDataType::String:
-			return AsJsonString() == AsJsonString();
-		case JsonDataType::Number:
-			return AsJsonNumber() == AsJsonNumber();
-		case JsonDataType::Boolean:
-			return AsJsonBoolean() == AsJsonBoolean();
-		case JsonDataType::Null:
-			return true; //  true
-		default:
-			throw WrongDataType(c.GetLineNo(), c.GetColumn(), "Unknown JSON data type.");
-			return false;
+			ReleaseDepth++;
+			JsonArrayParentType::clear();
+			ReleaseDepth--;
 		}
 	}
 
-	bool JsonData::operator !=(const JsonData& c) const
+	std::string JsonObject::ToString(int indent, int cur_indent, const std::string& indent_type) const
 	{
-		return !operator==(c);
+		SerializeStatistics Stat;
+		std::string s;
+		SerializeJson(s, *this, indent, cur_indent, indent_type);
+		return Stat.Finish(std::move(s));
 	}
 
-	bool JsonObject::operator ==(const JsonObject& c) const
+	JsonArray::JsonArray(size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Array, FromLineNo, FromColumn)
 	{
-		// һ
-		if (size() != c.size()) return false;
-
-		for (auto& kv : *this)
-		{
-			auto& key = kv.first;
-
-			// ÿ key ҵõ
-			if (!c.contains(key)) return false;
-
-			// ÿ Item ƥ
-			if (*kv.second != *c.at(key)) return false;
-		}
-
-		return true;
 	}
 
-	bool JsonObject::operator !=(const JsonObject& c) const
+	JsonArray::JsonArray(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc) :
+		JsonData(JsonDataType::Array, FromLineNo, FromColumn),
+		JsonArrayParentType(Alloc)
 	{
-		return !operator==(c);
 	}
 
-	bool JsonArray::operator ==(const JsonArray& c) const
+	JsonArray::JsonArray(const JsonAllocatorType& Alloc) :
+		JsonData(JsonDataType::Array, 0, 0),
+		JsonArrayParentType(Alloc)
 	{
-		if (size() != c.size()) return false;
-
-		for (size_t i = 0; i < size(); i++)
-		{
-			if (*at(i) != *c.at(i)) return false;
-		}
-
-		return true;
 	}
 
-	bool JsonArray::operator !=(const JsonArray& c) const
+	JsonTypedElements::JsonTypedElements(const double* First, const double* Last, bool Booleans, const JsonAllocatorType& Alloc) :
+		Numbers(First, Last, Alloc),
+		Integers(Alloc),
+		Type(Booleans ? ElementType::Boolean : ElementType::Number)
 	{
-		return !operator==(c);
 	}
 
-	bool JsonString::operator ==(const JsonString& c) const
-	{
-		return static_cast<const std::string&>(*this) == static_cast<const std::string&>(c);
-	}
-	bool JsonString::operator !=(const JsonString& c) const
+	JsonTypedElements::JsonTypedElements(const int64_t* First, const int64_t* Last, const JsonAllocatorType& Alloc) :
+		Numbers(Alloc),
+		Integers(First, Last, Alloc),
+		Type(ElementType::Integer)
 	{
-		return !operator==(c);
 	}
 
-	bool JsonNumber::operator ==(const JsonNumber& c) const
-	{
-		return Value == c.Value;
-	}
-	bool JsonNumber::operator !=(const JsonNumber& c) const
+	JsonDataPtr JsonTypedElements::MakeNode(size_t Index, const JsonAllocatorType& Alloc) const
 	{
-		return !operator==(c);
+		if (Type == ElementType::Boolean) return AllocateJsonPtr<JsonBoolean>(Alloc, GetBoolean(Index), 0, 0);
+		return AllocateJsonPtr<JsonNumber>(Alloc, GetNumber(Index), 0, 0);
 	}
 
-	bool JsonBoolean::operator ==(const JsonBoolean& c) const
+	JsonArray::JsonArray(const JsonData& Position, const JsonAllocatorType& Alloc) :
+		JsonData(Position),
+		JsonArrayParentType(Alloc)
 	{
-		return Value == c.Value;
-	}
-	bool JsonBoolean::operator !=(const JsonBoolean& c) const
-	{
-		return !operator==(c);
 	}
 
-	bool JsonNull::operator ==(const JsonNull& c) const
-	{
-		return true;
-	}
-	bool JsonNull::operator !=(const JsonNull& c) const
+	// A typed array is copied into nodes made from its buffer, leaving its own nodes unmade
+	JsonArray::JsonArray(const JsonArray& c) :
+		JsonArray(c, c.ShareTypedElements())
 	{
-		return !operator==(c);
 	}
 
-	JsonDataPtr& JsonData::operator [] (const std::string& key)
+	JsonArray::JsonArray(const JsonArray& c, std::shared_ptr<const JsonTypedElements> Typed) :
+		JsonData(c),
+		JsonArrayParentType(Typed ? JsonArrayParentType() : Loaded(c))
 	{
-		return operator [](JsonString(key, 0, 0));
+		Extended = false;
+		if (!Typed) return;
+		JsonAllocatorType Alloc(get_allocator());
+		reserve(Typed->size());
+		for (size_t i = 0; i < Typed->size(); i++) JsonArrayParentType::push_back(Typed->MakeNode(i, Alloc));
 	}
 
-	const JsonDataPtr& JsonData::at(const std::string& key) const
+	JsonArray::JsonArray(const JsonArray& c, const JsonAllocatorType& Alloc) :
+		JsonData(c),
+		JsonArrayParentType(Alloc)
 	{
-		return at(JsonString(key, 0, 0));
+		Extended = false;
+		if (auto Typed = c.ShareTypedElements())
+		{
+			reserve(Typed->size());
+			for (size_t i = 0; i < Typed->size(); i++) JsonArrayParentType::push_back(Typed->MakeNode(i, Alloc));
+		}
+		else JsonArrayParentType::operator =(Loaded(c));
 	}
 
-	JsonData::operator JsonString () const
+	JsonSourceArray::JsonSourceArray(size_t FromLineNo, size_t FromColumn) :
+		JsonArray(FromLineNo, FromColumn)
 	{
-		return JsonString(ToString(), LineNo, Column);
+		Extended = true;
 	}
 
-	template<typename T>
-	JsonDataPtr& JsonObject::operator [] (T key)
+	JsonSourceArray::JsonSourceArray(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc) :
+		JsonArray(FromLineNo, FromColumn, Alloc)
 	{
-		return JsonObjectParentType::operator[](JsonString(key, 0, 0));
+		Extended = true;
 	}
 
-	template<typename T>
-	bool JsonObject::contains(T key) const
+	// A copy of a typed array shares its buffer, and one whose elements are still deferred parses them itself
+	JsonSourceArray::JsonSourceArray(const JsonSourceArray& c) :
+		JsonArray(static_cast<const JsonData&>(c), JsonAllocatorType(c.get_allocator())),
+		SourceSpan(c.SourceSpan)
 	{
-		return JsonObjectParentType::contains(JsonString(key, 0, 0));
+		uint8_t Flags = c.Lazy.Get() & ~JsonLazyContent::Loading;
+		if ((Flags & JsonLazyContent::Pending) && !(Flags & JsonLazyContent::Typed)) Lazy.Set(Flags);
+		else if (auto Typed = c.TypedElements.load())
+		{
+			TypedElements.store(std::move(Typed));
+			Lazy.Set(JsonLazyContent::Pending | JsonLazyContent::Typed);
+		}
+		else JsonArrayParentType::operator =(Loaded(c));
 	}
 
-	template<typename T>
-	const JsonDataPtr& JsonObject::at(T key) const
+	JsonArray::JsonArray(const JsonArrayParentType& c, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Array, FromLineNo, FromColumn),
+		JsonArrayParentType(c)
 	{
-		return JsonObjectParentType::at(JsonString(key, 0, 0));
 	}
 
-	template bool JsonObject::contains(const std::string& Key) const;
-	template const JsonDataPtr& JsonObject::at(const std::string& Key) const;
-	template JsonDataPtr& JsonObject::operator [] (const std::string& Key);
-
-	template bool JsonObject::contains(const char* Key) const;
-	template const JsonDataPtr& JsonObject::at(const char* Key) const;
-	template JsonDataPtr& JsonObject::operator [] (const char* Key);
-
-	JsonDataPtr& JsonObject::operator [] (const JsonString& Key)
+	std::string JsonArray::ToString(int indent, int cur_indent, const std::string& indent_type) const
 	{
-		return JsonObjectParentType::operator[](Key);
+		SerializeStatistics Stat;
+		std::string s;
+		SerializeJson(s, *this, indent, cur_indent, indent_type);
+		return Stat.Finish(std::move(s));
 	}
 
-	const JsonDataPtr& JsonObject::at(const JsonString& Key) const
+	JsonString::JsonString(size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::String, FromLineNo, FromColumn)
 	{
-		return JsonObjectParentType::at(Key);
 	}
 
-	bool JsonObject::contains(const JsonString& Key) const
+	JsonString::JsonString(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc) :
+		JsonData(JsonDataType::String, FromLineNo, FromColumn),
+		JsonStringParentType(Alloc)
 	{
-		return JsonObjectParentType::contains(Key);
 	}
 
-	JsonDataPtr& JsonObject::operator [] (size_t Index)
+	JsonString::JsonString(const JsonAllocatorType& Alloc) :
+		JsonData(JsonDataType::String, 0, 0),
+		JsonStringParentType(Alloc)
 	{
-		char buf[128];
-		snprintf(buf, sizeof buf, "%zu", Index);
-		return operator [](buf);
 	}
 
-	const JsonDataPtr& JsonObject::at(size_t Index) const
+	JsonString::JsonString(std::string_view Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::String, FromLineNo, FromColumn),
+		JsonStringParentType(Value)
 	{
-		char buf[128];
-		snprintf(buf, sizeof buf, "%zu", Index);
-		return at(buf);
 	}
 
-	JsonObject::operator double() const
+	JsonString::JsonString(std::string_view Value, size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc) :
+		JsonData(JsonDataType::String, FromLineNo, FromColumn),
+		JsonStringParentType(Value, Alloc)
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	JsonDataPtr& JsonArray::operator [] (const JsonString& Key)
+	JsonString::JsonString(const JsonString& c, const JsonAllocatorType& Alloc) :
+		JsonData(c),
+		JsonStringParentType(c, Alloc)
 	{
-		return operator[](size_t(std::stoull(Key)));
 	}
 
-	JsonDataPtr& JsonArray::operator [] (const std::string& Key)
+	JsonString::JsonString(JsonString&& c, const JsonAllocatorType& Alloc) :
+		JsonData(c),
+		JsonStringParentType(std::move(c), Alloc)
 	{
-		return operator[](size_t(std::stoull(Key)));
 	}
 
-	const JsonDataPtr& JsonArray::at(const std::string& Key) const
+	std::string JsonString::ToString(int indent, int cur_indent, const std::string& indent_type) const
 	{
-		return at(size_t(std::stoull(Key)));
+		SerializeStatistics Stat;
+		std::string s;
+		s.reserve(size() + 2);
+		s += '"';
+		EscapeJsonString(s, *this);
+		s += '"';
+		return Stat.Finish(std::move(s));
 	}
 
-	const JsonDataPtr& JsonArray::at(const JsonString& Key) const
+	JsonNumber::JsonNumber(size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
+		Value(0)
 	{
-		return at(size_t(std::stoull(Key)));
 	}
 
-	bool JsonArray::contains(const JsonString& Key) const
+	JsonNumber::JsonNumber(std::int32_t Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
+		Value(static_cast<double>(Value))
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
 	}
-
-	JsonDataPtr& JsonArray::operator [] (size_t Index)
+	JsonNumber::JsonNumber(std::int64_t Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
+		Value(static_cast<double>(Value))
 	{
-		return JsonArrayParentType::operator[](Index);
 	}
-
-	const JsonDataPtr& JsonArray::at(size_t Index) const
+	JsonNumber::JsonNumber(std::uint32_t Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
+		Value(static_cast<double>(Value))
 	{
-		return JsonArrayParentType::at(Index);
 	}
-
-	JsonArray::operator double() const
+	JsonNumber::JsonNumber(std::uint64_t Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
+		Value(static_cast<double>(Value))
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
 	}
-
-	JsonDataPtr& JsonString::operator [] (const JsonString& Key)
+	JsonNumber::JsonNumber(float Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
+		Value(static_cast<double>(Value))
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
 	}
-
-	const JsonDataPtr& JsonString::at(const JsonString& Key) const
+	JsonNumber::JsonNumber(double Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Number, FromLineNo, FromColumn),
+		Value(Value)
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
 	}
-
-	bool JsonString::contains(const JsonString& Key) const
+	JsonLazyNumber::JsonLazyNumber(std::string_view Literal, double Value, size_t FromLineNo, size_t FromColumn) :
+		JsonNumber(Value, FromLineNo, FromColumn),
+		Parsed(Value),
+		Size(static_cast<uint8_t>(Literal.size()))
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+		memcpy(this->Literal, Literal.data(), Literal.size());
 	}
 
-	JsonDataPtr& JsonString::operator [] (size_t Index)
+	std::string_view JsonNumber::GetLiteral() const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		return std::string_view();
 	}
 
-	const JsonDataPtr& JsonString::at(size_t Index) const
+	// Compared bit by bit, so that assigning -0 to a parsed 0 or another NaN still drops the literal
+	std::string_view JsonLazyNumber::GetLiteral() const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		if (memcmp(&Value, &Parsed, sizeof(double))) return std::string_view();
+		return std::string_view(Literal, Size);
 	}
 
-	JsonString::operator double() const
+	std::string JsonNumber::ToString(int indent, int cur_indent, const std::string& indent_type) const
 	{
-		return std::stod(*this);
-	}
+		char buf[256];
+		SerializeStatistics Stat;
 
-	JsonDataPtr& JsonNumber::operator [] (const JsonString& Key)
-	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+		auto Literal = GetLiteral();
+		if (Literal.size()) return Stat.Finish(std::string(Literal));
+		return Stat.Finish(std::string(FormatNumber(buf, Value)));
 	}
 
-	const JsonDataPtr& JsonNumber::at(const JsonString& Key) const
+	JsonBoolean::JsonBoolean(size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Boolean, FromLineNo, FromColumn),
+		Value(0)
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	bool JsonNumber::contains(const JsonString& Key) const
+	JsonBoolean::JsonBoolean(bool Value, size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Boolean, FromLineNo, FromColumn),
+		Value(Value)
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	JsonDataPtr& JsonNumber::operator [] (size_t Index)
+	std::string JsonBoolean::ToString(int indent, int cur_indent, const std::string& indent_type) const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		SerializeStatistics Stat;
+		if (Value) return Stat.Finish("true");
+		else return Stat.Finish("false");
 	}
 
-	const JsonDataPtr& JsonNumber::at(size_t Index) const
+	JsonNull::JsonNull(size_t FromLineNo, size_t FromColumn) :
+		JsonData(JsonDataType::Null, FromLineNo, FromColumn)
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	JsonNumber::operator double() const
+	std::string JsonNull::ToString(int indent, int cur_indent, const std::string& indent_type) const
 	{
-		return Value;
+		SerializeStatistics Stat;
+		return Stat.Finish("null");
 	}
 
-	JsonDataPtr& JsonBoolean::operator [] (const JsonString& Key)
+	size_t JsonData::GetLineNo() const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+		return LineNo;
 	}
 
-	const JsonDataPtr& JsonBoolean::at(const JsonString& Key) const
+	size_t JsonData::GetColumn() const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+		return Column;
 	}
 
-	bool JsonBoolean::contains(const JsonString& Key) const
+	void JsonData::Invalidate()
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
 	}
 
-	JsonDataPtr& JsonBoolean::operator [] (size_t Index)
+	void JsonSourceObject::Invalidate()
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		Load();
+		SourceSpan.reset();
 	}
 
-	const JsonDataPtr& JsonBoolean::at(size_t Index) const
+	void JsonSourceArray::Invalidate()
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		Load();
+		SourceSpan.reset();
 	}
 
-	JsonBoolean::operator double() const
+	uint8_t JsonLazyContent::Claim(uint8_t Unless) const
 	{
-		return Value ? 1.0 : 0.0;
+		uint8_t f = Get();
+		for (;;)
+		{
+			if (!(f & Pending) || (f & Unless)) return 0;
+			if (f & Loading)
+			{
+				Flags.wait(f, std::memory_order_acquire);
+				f = Get();
+			}
+			else if (Flags.compare_exchange_weak(f, f | Loading, std::memory_order_acquire)) return f | Loading;
+		}
 	}
 
-	JsonDataPtr& JsonNull::operator [] (const JsonString& Key)
+	void JsonLazyContent::Release(uint8_t f) const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+		Set(f);
+		Flags.notify_all();
 	}
 
-	const JsonDataPtr& JsonNull::at(const JsonString& Key) const
+	static void SetUpLazyParser(JsonParser& jp, const JsonData& Container, const JsonSourceSpan& Span, uint8_t Flags)
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+		jp.LazyText = Span;
+		jp.LazyDepth = 1;
+		jp.MaxDepth = SIZE_MAX; // The first parse checked the depth, so that this one can't fail on it
+		jp.TrackPositions = Flags & JsonLazyContent::TrackPositions;
+		jp.AllowComments = Flags & JsonLazyContent::AllowComments;
+		jp.LazyNumbers = Flags & JsonLazyContent::LazyNumbers;
+		jp.TypedArrays = Flags & JsonLazyContent::TypedArrays;
+		if (jp.TrackPositions) jp.SetOrigin(Container.GetLineNo(), Container.GetColumn());
 	}
 
-	bool JsonNull::contains(const JsonString& Key) const
+	// The members are parsed from the span the way the first parse would have, the containers among them deferred in turn.
+	// That parse checked the span, so this one only fails to allocate; the claim is then given back for the next access.
+	void JsonObject::LoadMembers() const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
-	}
+		auto& Source = static_cast<const JsonSourceObject&>(*this);
+		uint8_t Flags = Source.Lazy.Claim();
+		if (!Flags) return;
 
-	JsonDataPtr& JsonNull::operator [] (size_t Index)
-	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		try
+		{
+			JsonParser jp(Source.SourceSpan.View(), JsonAllocatorType(get_allocator()));
+			SetUpLazyParser(jp, *this, Source.SourceSpan, Flags);
+			auto Parsed = ParseJson(jp);
+			if (!Parsed) jp.GetErrorResult().Throw();
+			auto& Members = const_cast<JsonObjectParentType&>(static_cast<const JsonObjectParentType&>(*this));
+			Members.swap(static_cast<JsonObjectParentType&>(static_cast<JsonObject&>(*Parsed)));
+		}
+		catch (...)
+		{
+			Source.Lazy.Release(Flags & ~JsonLazyContent::Loading);
+			throw;
+		}
+		Source.Lazy.Release(0);
 	}
 
-	const JsonDataPtr& JsonNull::at(size_t Index) const
+	// A typed array makes its nodes and drops the buffer, which readers that loaded it keep until they are done.
+	// The flags are cleared first, so that a reader finding no buffer finds the nodes.
+	void JsonArray::LoadMembers(bool KeepTyped) const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+		auto& Source = static_cast<const JsonSourceArray&>(*this);
+		uint8_t Flags = Source.Lazy.Claim(KeepTyped ? JsonLazyContent::Typed : 0);
+		if (!Flags) return;
+
+		auto& Elements = const_cast<JsonArrayParentType&>(static_cast<const JsonArrayParentType&>(*this));
+		JsonAllocatorType Alloc(get_allocator());
+		try
+		{
+			if (Flags & JsonLazyContent::Typed)
+			{
+				auto Typed = Source.TypedElements.load();
+				Elements.reserve(Typed->size());
+				for (size_t i = 0; i < Typed->size(); i++) Elements.push_back(Typed->MakeNode(i, Alloc));
+				Source.Lazy.Release(0);
+				Source.TypedElements.store(nullptr);
+				return;
+			}
+
+			JsonParser jp(Source.SourceSpan.View(), Alloc);
+			SetUpLazyParser(jp, *this, Source.SourceSpan, Flags);
+			auto Parsed = ParseJson(jp);
+			if (!Parsed) jp.GetErrorResult().Throw();
+			auto& Array = static_cast<JsonArray&>(*Parsed);
+			if (auto Typed = Array.ShareTypedElements())
+			{
+				// Parsed typed, and kept so until an element is accessed as a node
+				Source.TypedElements.store(std::move(Typed));
+				Source.Lazy.Release(JsonLazyContent::Pending | JsonLazyContent::Typed);
+				return;
+			}
+			Elements.swap(static_cast<JsonArrayParentType&>(Array));
+		}
+		catch (...)
+		{
+			Elements.clear();
+			Source.Lazy.Release(Flags & ~JsonLazyContent::Loading);
+			throw;
+		}
+		Source.Lazy.Release(0);
 	}
 
-	JsonNull::operator double() const
+	JsonArray::size_type JsonArray::LoadedSize() const
 	{
-		throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+		if (auto Typed = LoadTypedElements()) return Typed->size();
+		Load(); // Also waits for nodes being made meanwhile
+		return JsonArrayParentType::size();
 	}
 
-	JsonDataPtr ParseJson(const std::string& s)
+	// Parses the elements of a deferred array first, which can turn out typed
+	std::shared_ptr<const JsonTypedElements> JsonArray::LoadTypedElements() const
 	{
-		return JsonData::ParseJson(s);
+		LoadMembers(true);
+		return static_cast<const JsonSourceArray&>(*this).TypedElements.load();
 	}
 
-	JsonDataPtr ParseJsonFromString(const std::string& s)
+	static const JsonSourceSpan NoSourceSpan;
+
+	const JsonSourceSpan& JsonObject::GetSourceSpan() const
 	{
-		return JsonData::ParseJson(s);
+		return Extended ? static_cast<const JsonSourceObject&>(*this).SourceSpan : NoSourceSpan;
 	}
 
-	JsonDataPtr ParseJsonFromFile(const std::string& FilePath)
+	const JsonSourceSpan& JsonArray::GetSourceSpan() const
 	{
-		std::ifstream ifs(FilePath);
-		std::stringstream ss;
-		if (ifs.fail())
-		{
-			ss << "Could not read `" << FilePath << "`";
-			throw JsonDecodeError(0, 0, ss.str());
-		}
-		ss << ifs.rdbuf();
-		return JsonData::ParseJson(ss.str());
+		return Extended ? static_cast<const JsonSourceArray&>(*this).SourceSpan : NoSourceSpan;
 	}
 
-	JsonDataPtr Copy(JsonDataPtr Json)
+	JsonSourceSpan::JsonSourceSpan() :
+		Size(0)
 	{
-		return Copy(*Json);
 	}
 
-	JsonDataPtr Copy(const JsonData& Json)
+	JsonSourceSpan::JsonSourceSpan(const std::shared_ptr<const std::string>& Source, size_t Begin, size_t End) :
+		Data(Source, Source->data() + Begin),
+		Size(End - Begin)
 	{
-		return Json.Copy();
 	}
 
-	JsonDataPtr JsonObject::Copy() const
+	JsonSourceSpan::JsonSourceSpan(const JsonSourceSpan& Within, size_t Begin, size_t End) :
+		Data(Within.Data, Within.Data.get() + Begin),
+		Size(End - Begin)
 	{
-		return MakeJsonObjectPtr(*this);
 	}
 
-	JsonDataPtr JsonArray::Copy() const
+	std::string_view JsonSourceSpan::View() const
 	{
-		return MakeJsonArrayPtr(*this);
+		return std::string_view(Data.get(), Size);
 	}
 
-	JsonDataPtr JsonString::Copy() const
+	JsonSourceSpan::operator bool() const
 	{
-		return MakeJsonStringPtr(*this);
+		return Data != nullptr;
 	}
 
-	JsonDataPtr JsonNumber::Copy() const
+	void JsonSourceSpan::reset()
 	{
-		return MakeJsonNumberPtr(*this);
+		Data.reset();
+		Size = 0;
 	}
 
-	JsonDataPtr JsonBoolean::Copy() const
+	std::string ToStringSpliced(const JsonData& Json, int indent, const std::string& indent_type)
 	{
-		return MakeJsonBooleanPtr(*this);
+		SpliceScope Splice;
+		return Json.ToString(indent, 0, indent_type);
 	}
 
-	JsonDataPtr JsonNull::Copy() const
+	// Plans a document as a list of pieces whose concatenation is its ToString() output.
+	// Literal pieces hold brackets, keys and whitespace around the split containers; the others are filled in by the workers
+	// of a JsonTaskPool, each as soon as it is planned, and the caller too once planning is done.
+	class JsonParallelSerializer
 	{
-		return MakeJsonNullPtr(*this);
+	protected:
+		enum class PieceKind
+		{
+			Literal,
+			Members, // Count members of Object from ObjectBegin
+			Elements, // Count elements of Array from First
+		};
+
+		struct Piece
+		{
+			PieceKind Kind;
+			std::string Text;
+			const JsonObject* Object;
+			JsonObject::const_iterator ObjectBegin;
+			const JsonArray* Array;
+			size_t First; // Index of the first member or element
+			size_t Count;
+			int CurIndent; // Indent of the members
+			bool Done; // Filled in, under the lock of the Work
+
+			explicit Piece(PieceKind Kind) :
+				Kind(Kind),
+				Object(nullptr),
+				ObjectBegin(),
+				Array(nullptr),
+				First(0),
+				Count(0),
+				CurIndent(0),
+				Done(Kind == PieceKind::Literal)
+			{
+			}
+		};
+
+		// The planned pieces still waiting for a thread. It is shared with the helpers queued on the pool, which may only get to run
+		// after the call is over: they find nothing left then and return without touching the serializer.
+		struct Work
+		{
+			std::mutex Lock;
+			std::condition_variable Changed; // A piece was queued or filled in, planning ended, or a piece failed
+			std::deque<Piece*> Ready;
+			JsonParallelSerializer* Serializer = nullptr;
+			size_t Busy = 0; // Pieces being filled in by helpers
+			bool Planned = false;
+			bool Utf8 = false;
+			std::exception_ptr Error;
+		};
+
+		int Indent;
+		const std::string& IndentType;
+		size_t ChunkNodes;
+		std::deque<Piece> Pieces; // Stays in place while growing, for the helpers filling in the pieces already planned
+		std::vector<const JsonData*> Pending; // Scratch stack of CountNodes()
+		std::shared_ptr<Work> Shared;
+
+		// Containers nested deeper than MaxPlanDepth are serialized whole rather than planned, which bounds the recursion
+		static constexpr size_t MaxPlanDepth = 64;
+		size_t Depth = 0;
+
+		// Counts the nodes of a subtree, giving up at Limit
+		static size_t CountNodes(const JsonData& Json, size_t Limit, std::vector<const JsonData*>& Pending)
+		{
+			// Every pending node counts at least one
+			size_t Count = 0;
+			Pending.assign(1, &Json);
+			auto Push = [&](const JsonData* Node)
+			{
+				Pending.push_back(Node);
+				return Count + Pending.size() < Limit;
+			};
+			while (!Pending.empty())
+			{
+				const JsonData* Node = Pending.back();
+				Pending.pop_back();
+				Count++;
+				if (auto Object = Node->TryAsJsonObject())
+				{
+					for (auto& Member : *Object) if (!Push(Member.second.get())) return Limit;
+				}
+				else if (auto Array = Node->TryAsJsonArray())
+				{
+					// The elements of a typed array count as the nodes they would be
+					if (auto Typed = Array->ShareTypedElements())
+					{
+						Count += Typed->size();
+						if (Count + Pending.size() >= Limit) return Limit;
+					}
+					else for (auto& Element : *Array) if (!Push(Element.get())) return Limit;
+				}
+			}
+			return Count;
+		}
+
+		size_t CountNodes(const JsonData& Json, size_t Limit)
+		{
+			return CountNodes(Json, Limit, Pending);
+		}
+
+		std::string& Literal()
+		{
+			if (Pieces.empty() || Pieces.back().Kind != PieceKind::Literal) Pieces.emplace_back(PieceKind::Literal);
+			return Pieces.back().Text;
+		}
+
+		void AddIndent(std::string& s, int cur_indent)
+		{
+			for (int i = 0; i < cur_indent; i++) s += IndentType;
+		}
+
+		// Member prefix as JsonObject::ToString() writes it
+		void AddKey(std::string& s, int cur_indent, std::string_view Key)
+		{
+			AddIndent(s, cur_indent);
+			s += "\"";
+			EscapeJsonString(s, Key);
+			s += "\":";
+			if (Indent) s += " ";
+		}
+
+		void AddSeparator(std::string& s, bool Last)
+		{
+			if (!Last) s += ",";
+			if (Indent) s += "\n";
+		}
+
+		// Groups the children of a container into ranges of about ChunkNodes nodes, planning the large children on their own
+		template<typename Iterator, typename AddRange, typename AddPrefix>
+		void PlanChildren(Iterator Begin, Iterator End, size_t Size, int cur_indent, AddRange Range, AddPrefix Prefix)
+		{
+			size_t RangeCount = 0, RangeNodes = 0, Index = 0;
+			Iterator RangeBegin = Begin;
+			for (auto it = Begin; it != End; it++, Index++)
+			{
+				const JsonData& Child = *GetChild(*it);
+				size_t Nodes = CountNodes(Child, ChunkNodes);
+				if (Nodes >= ChunkNodes && (Child.GetType() == JsonDataType::Object || Child.GetType() == JsonDataType::Array))
+				{
+					if (RangeCount) Range(RangeBegin, Index - RangeCount, RangeCount);
+					RangeCount = RangeNodes = 0;
+					Prefix(*it);
+					Plan(Child, cur_indent);
+					AddSeparator(Literal(), Index + 1 == Size);
+					continue;
+				}
+				if (!RangeCount) RangeBegin = it;
+				RangeCount++;
+				RangeNodes += Nodes;
+				if (RangeNodes >= ChunkNodes)
+				{
+					Range(RangeBegin, Index + 1 - RangeCount, RangeCount);
+					RangeCount = RangeNodes = 0;
+				}
+			}
+			if (RangeCount) Range(RangeBegin, Index - RangeCount, RangeCount);
+		}
+
+		static const JsonDataPtr& GetChild(const JsonObject::value_type& Member) { return Member.second; }
+		static const JsonDataPtr& GetChild(const JsonDataPtr& Element) { return Element; }
+
+		void Plan(const JsonData& Json, int cur_indent)
+		{
+			bool IsObject = Json.GetType() == JsonDataType::Object;
+			bool IsTyped = !IsObject && Json.GetType() == JsonDataType::Array && Json.AsJsonArray().ShareTypedElements();
+			if ((!IsObject && Json.GetType() != JsonDataType::Array) || IsTyped || Depth >= MaxPlanDepth || CountNodes(Json, ChunkNodes) < ChunkNodes)
+			{
+				// Not worth splitting, or a typed array written from its buffer
+				Pieces.emplace_back(PieceKind::Literal);
+				Pieces.back().Text = Json.ToString(Indent, cur_indent, IndentType);
+				return;
+			}
+			Depth++;
+
+			Literal() += IsObject ? "{" : "[";
+			if (Indent) Literal() += "\n";
+			int Inner = cur_indent + Indent;
+			if (IsObject)
+			{
+				auto& Object = Json.AsJsonObject();
+				PlanChildren(Object.cbegin(), Object.cend(), Object.size(), Inner,
+					[&](JsonObject::const_iterator Begin, size_t First, size_t Count)
+					{
+						Piece p(PieceKind::Members);
+						p.Object = &Object;
+						p.ObjectBegin = Begin;
+						p.Count = Count;
+						p.First = First;
+						p.CurIndent = Inner;
+						Queue(std::move(p));
+					},
+					[&](const JsonObject::value_type& Member) { AddKey(Literal(), Inner, Member.first); });
+			}
+			else
+			{
+				auto& Array = Json.AsJsonArray();
+				PlanChildren(Array.cbegin(), Array.cend(), Array.size(), Inner,
+					[&](JsonArray::const_iterator, size_t First, size_t Count)
+					{
+						Piece p(PieceKind::Elements);
+						p.Array = &Array;
+						p.First = First;
+						p.Count = Count;
+						p.CurIndent = Inner;
+						Queue(std::move(p));
+					},
+					[&](const JsonDataPtr&) { AddIndent(Literal(), Inner); });
+			}
+			AddIndent(Literal(), cur_indent);
+			Literal() += IsObject ? "}" : "]";
+			Depth--;
+		}
+
+		void Queue(Piece&& p)
+		{
+			Pieces.push_back(std::move(p));
+			if (1)
+			{
+				std::lock_guard<std::mutex> Guard(Shared->Lock);
+				Shared->Ready.push_back(&Pieces.back());
+			}
+			Shared->Changed.notify_one();
+		}
+
+		void Serialize(Piece& p)
+		{
+			std::string& s = p.Text;
+			if (p.Kind == PieceKind::Members)
+			{
+				auto it = p.ObjectBegin;
+				for (size_t i = 0; i < p.Count; i++, it++)
+				{
+					AddKey(s, p.CurIndent, it->first);
+					SerializeJson(s, *it->second, Indent, p.CurIndent, IndentType);
+					AddSeparator(s, p.First + i + 1 == p.Object->size());
+				}
+			}
+			else
+			{
+				for (size_t i = p.First; i < p.First + p.Count; i++)
+				{
+					AddIndent(s, p.CurIndent);
+					SerializeJson(s, *p.Array->cbegin()[i], Indent, p.CurIndent, IndentType);
+					AddSeparator(s, i + 1 == p.Array->size());
+				}
+			}
+		}
+
+		// Takes the next piece waiting and fills it in, or returns false when there is none
+		static bool FillNext(Work& w, std::unique_lock<std::mutex>& Guard)
+		{
+			if (w.Ready.empty()) return false;
+			Piece& p = *w.Ready.front();
+			w.Ready.pop_front();
+			w.Busy++;
+			Guard.unlock();
+			std::exception_ptr Error;
+			try
+			{
+				JsonUtf8OutputScope Scope(w.Utf8);
+				w.Serializer->Serialize(p);
+			}
+			catch (...)
+			{
+				Error = std::current_exception();
+			}
+			Guard.lock();
+			if (Error)
+			{
+				if (!w.Error) w.Error = Error;
+				w.Ready.clear();
+			}
+			p.Done = true;
+			w.Busy--;
+			w.Changed.notify_all();
+			return true;
+		}
+
+		// Runs on the pool until planning is over and nothing is left waiting
+		static void Help(const std::shared_ptr<Work>& w)
+		{
+			std::unique_lock<std::mutex> Guard(w->Lock);
+			for (;;)
+			{
+				w->Changed.wait(Guard, [&]() { return !w->Ready.empty() || w->Planned; });
+				if (!FillNext(*w, Guard)) return;
+			}
+		}
+
+		// Drops what is still waiting and waits for the helpers busy with a piece, so none touches the serializer afterwards
+		void Stop()
+		{
+			std::unique_lock<std::mutex> Guard(Shared->Lock);
+			Shared->Planned = true;
+			Shared->Ready.clear();
+			Shared->Changed.notify_all();
+			Shared->Changed.wait(Guard, [this]() { return !Shared->Busy; });
+		}
+
+	public:
+		JsonParallelSerializer(int indent, const std::string& indent_type, size_t ChunkNodes) :
+			Indent(indent),
+			IndentType(indent_type),
+			ChunkNodes(ChunkNodes ? ChunkNodes : 1),
+			Shared(std::make_shared<Work>())
+		{
+			Shared->Serializer = this;
+			Shared->Utf8 = Utf8Output;
+		}
+
+		~JsonParallelSerializer()
+		{
+			Stop();
+		}
+
+		// The threads working on one call: the caller and as many of the pool's workers as Threads allows
+		static size_t ResolveThreads(const JsonParallelOptions& Options)
+		{
+			size_t Available = (Options.Pool ? *Options.Pool : JsonTaskPool::GetDefault()).GetThreads() + 1;
+			return Options.Threads ? std::min(Options.Threads, Available) : Available;
+		}
+
+		// Planning costs a walk over the nodes, which only pays off when at least two threads get a chunk each
+		static bool WorthSplitting(const JsonData& Json, const JsonParallelOptions& Options)
+		{
+			std::vector<const JsonData*> Pending;
+			size_t Limit = 2 * std::max<size_t>(Options.ChunkNodes, 1);
+			return ResolveThreads(Options) > 1 && CountNodes(Json, Limit, Pending) >= Limit;
+		}
+
+		// Plans Json while Threads - 1 helpers on Pool fill in the pieces, then helps with the rest and passes the pieces to Sink
+		// in order, each as soon as it is done. Returns the number of bytes written.
+		size_t Run(const JsonData& Json, JsonTaskPool& Pool, size_t Threads, const std::function<void(std::string_view)>& Sink)
+		{
+			for (size_t i = 1; i < Threads; i++) Pool.Submit([w = Shared]() { Help(w); });
+			Plan(Json, 0);
+
+			size_t Bytes = 0;
+			std::unique_lock<std::mutex> Guard(Shared->Lock);
+			Shared->Planned = true;
+			Shared->Changed.notify_all();
+			for (auto& p : Pieces)
+			{
+				while (!p.Done && !Shared->Error)
+				{
+					if (!FillNext(*Shared, Guard)) Shared->Changed.wait(Guard);
+				}
+				if (Shared->Error)
+				{
+					Guard.unlock();
+					Stop();
+					std::rethrow_exception(Shared->Error);
+				}
+				Guard.unlock();
+				Sink(p.Text);
+				Bytes += p.Text.size();
+				std::string().swap(p.Text);
+				Guard.lock();
+			}
+			return Bytes;
+		}
+	};
+
+	JsonTaskPool::JsonTaskPool(size_t Threads) :
+		Stopping(false)
+	{
+		if (!Threads) Threads = std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1;
+		for (size_t i = 0; i < Threads; i++) Workers.emplace_back(&JsonTaskPool::Run, this);
+	}
+
+	JsonTaskPool::~JsonTaskPool()
+	{
+		if (1)
+		{
+			std::lock_guard<std::mutex> Guard(Lock);
+			Stopping = true;
+		}
+		Ready.notify_all();
+		for (auto& Worker : Workers) Worker.join();
+	}
+
+	void JsonTaskPool::Run()
+	{
+		std::unique_lock<std::mutex> Guard(Lock);
+		for (;;)
+		{
+			Ready.wait(Guard, [this]() { return !Queue.empty() || Stopping; });
+			if (Queue.empty()) return;
+
+			auto Task = std::move(Queue.front());
+			Queue.pop_front();
+			Guard.unlock();
+			Task();
+			Task = nullptr;
+			Guard.lock();
+		}
+	}
+
+	size_t JsonTaskPool::GetThreads() const
+	{
+		return Workers.size();
+	}
+
+	void JsonTaskPool::Submit(std::function<void()> Task)
+	{
+		// Without workers nobody would ever run it
+		if (Workers.empty())
+		{
+			Task();
+			return;
+		}
+		if (1)
+		{
+			std::lock_guard<std::mutex> Guard(Lock);
+			Queue.push_back(std::move(Task));
+		}
+		Ready.notify_one();
+	}
+
+	JsonTaskPool& JsonTaskPool::GetDefault()
+	{
+		static JsonTaskPool Pool;
+		return Pool;
+	}
+
+	void WriteJsonParallel(const JsonData& Json, const std::function<void(std::string_view)>& Sink, int indent, const std::string& indent_type, const JsonParallelOptions& Options)
+	{
+		SerializeStatistics Stat;
+		if (!JsonParallelSerializer::WorthSplitting(Json, Options))
+		{
+			std::string s;
+			SerializeJson(s, Json, indent, 0, indent_type);
+			Sink(s);
+			Stat.Finish(s.size());
+			return;
+		}
+		JsonParallelSerializer Serializer(indent, indent_type, Options.ChunkNodes);
+		auto& Pool = Options.Pool ? *Options.Pool : JsonTaskPool::GetDefault();
+		Stat.Finish(Serializer.Run(Json, Pool, JsonParallelSerializer::ResolveThreads(Options), Sink));
+	}
+
+	std::string ToStringParallel(const JsonData& Json, int indent, const std::string& indent_type, const JsonParallelOptions& Options)
+	{
+		SerializeStatistics Stat;
+		std::string s;
+		if (!JsonParallelSerializer::WorthSplitting(Json, Options))
+		{
+			SerializeJson(s, Json, indent, 0, indent_type);
+			return Stat.Finish(std::move(s));
+		}
+		// Each chunk is appended and dropped as soon as it is done, so the chunks and the result are never all held at once
+		JsonParallelSerializer Serializer(indent, indent_type, Options.ChunkNodes);
+		auto& Pool = Options.Pool ? *Options.Pool : JsonTaskPool::GetDefault();
+		Serializer.Run(Json, Pool, JsonParallelSerializer::ResolveThreads(Options), [&s](std::string_view Chunk) { s += Chunk; });
+		return Stat.Finish(std::move(s));
+	}
+
+	JsonEncodeError::JsonEncodeError(const std::string& what) noexcept :
+		std::runtime_error(what)
+	{
+	}
+
+	// Member names in the order of their UTF-16 code units, as RFC 8785 sorts them.
+	// UTF-8 bytes compare like code points, which only differs for characters from U+10000 on (surrogate pairs in UTF-16)
+	// against U+E000 to U+FFFF, so only the first differing character needs a look.
+	static bool Utf16Less(std::string_view a, std::string_view b)
+	{
+		size_t n = std::min(a.size(), b.size());
+		size_t i = static_cast<size_t>(std::mismatch(a.begin(), a.begin() + n, b.begin()).first - a.begin());
+		if (i == n) return a.size() < b.size();
+
+		size_t Lead = i;
+		while (Lead > 0 && (static_cast<uint8_t>(a[Lead]) & 0xC0) == 0x80) Lead--;
+		uint8_t x = static_cast<uint8_t>(a[Lead]), y = static_cast<uint8_t>(b[Lead]);
+		if (x >= 0xF0 && (y == 0xEE || y == 0xEF)) return true;
+		if (y >= 0xF0 && (x == 0xEE || x == 0xEF)) return false;
+		return static_cast<uint8_t>(a[i]) < static_cast<uint8_t>(b[i]);
+	}
+
+	// The shortest digits that read back as Value, laid out as ECMAScript's Number.prototype.toString() does
+	static void AppendCanonicalNumber(std::string& Out, double Value)
+	{
+		if (!std::isfinite(Value)) throw JsonEncodeError("can't write NaN or infinity in canonical JSON");
+		if (Value == 0)
+		{
+			// -0 too
+			Out += '0';
+			return;
+		}
+		if (Value < 0)
+		{
+			Out += '-';
+			Value = -Value;
+		}
+
+		// d.ddde+x, from which the digits and the position n of the decimal point after the first of them
+		char buf[32];
+		char* End = std::to_chars(buf, buf + sizeof buf - 1, Value, std::chars_format::scientific).ptr;
+		*End = 0;
+		char* Exp = std::find(buf, End, 'e');
+		char Digits[20];
+		int k = 0;
+		for (char* p = buf; p < Exp; p++)
+		{
+			if (*p != '.') Digits[k++] = *p;
+		}
+		int n = static_cast<int>(strtol(Exp + 1, nullptr, 10)) + 1;
+
+		if (k <= n && n <= 21)
+		{
+			Out.append(Digits, k);
+			Out.append(n - k, '0');
+		}
+		else if (0 < n && n <= 21)
+		{
+			Out.append(Digits, n);
+			Out += '.';
+			Out.append(Digits + n, k - n);
+		}
+		else if (-6 < n && n <= 0)
+		{
+			Out += "0.";
+			Out.append(-n, '0');
+			Out.append(Digits, k);
+		}
+		else
+		{
+			Out += Digits[0];
+			if (k > 1)
+			{
+				Out += '.';
+				Out.append(Digits + 1, k - 1);
+			}
+			Out += n > 0 ? "e+" : "e-";
+			Out += std::to_string(n > 0 ? n - 1 : 1 - n);
+		}
+	}
+
+	// s quoted with only '"', '\\' and control characters escaped; the rest is copied once checked to be valid UTF-8
+	static void AppendCanonicalString(std::string& Out, std::string_view s)
+	{
+		static const char Digits[] = "0123456789abcdef";
+		Utf8Parser jp(s);
+		size_t i = 0;
+		Out += '"';
+		while (i < s.size())
+		{
+			size_t Plain = CountPlainBytes(s.data() + i, s.size() - i, false);
+			Out.append(s.data() + i, Plain);
+			i += Plain;
+			jp.Skip(Plain);
+			if (i == s.size()) break;
+
+			uint8_t b = static_cast<uint8_t>(s[i]);
+			if (b < 0x80)
+			{
+				i++;
+				jp.Skip(1);
+				switch (b)
+				{
+				case '"': Out += "\\\""; break;
+				case '\\': Out += "\\\\"; break;
+				case '\b': Out += "\\b"; break;
+				case '\f': Out += "\\f"; break;
+				case '\n': Out += "\\n"; break;
+				case '\r': Out += "\\r"; break;
+				case '\t': Out += "\\t"; break;
+				default:
+					if (1)
+					{
+						char buf[6] = { '\\', 'u', '0', '0', Digits[b >> 4], Digits[b & 0xF] };
+						Out.append(buf, sizeof buf);
+					}
+					break;
+				}
+				continue;
+			}
+
+			int ch = jp.GetChar();
+			if (ch < 0) throw UnicodeDecodeError(jp.GetLineNo(), jp.GetColumn(), Utf8ErrorMessage(b, ch == Utf8Parser::TruncatedUtf8));
+			if (ch >= 0xD800 && ch <= 0xDFFF) throw JsonEncodeError("can't write a lone surrogate in canonical JSON");
+			size_t Next = jp.Offset();
+
+			// The decoder takes overlong forms and stray bytes after the first; what encodes back differently isn't UTF-8
+			char buf[6];
+			if (ch > 0x10FFFF || Utf8Parser::EncodeUnicode(buf, ch) != Next - i || memcmp(buf, s.data() + i, Next - i))
+			{
+				throw UnicodeDecodeError(jp.GetLineNo(i), jp.GetColumn(i), Utf8ErrorMessage(b, false));
+			}
+			Out.append(s.data() + i, Next - i);
+			i = Next;
+		}
+		Out += '"';
+	}
+
+	// Appends the canonical form of Json to Out, handing Out to Sink (when given) and clearing it whenever it reaches BufferSize.
+	// Objects whose members are already in UTF-16 order, which is nearly always, are walked as they are; others through a sorted copy.
+	static void SerializeCanonical(std::string& Out, const JsonData& Json, const std::function<void(std::string_view)>* Sink, size_t BufferSize)
+	{
+		using Member = JsonObject::value_type;
+		auto NameLess = [](const Member* a, const Member* b) { return Utf16Less(a->first, b->first); };
+
+		struct Frame
+		{
+			const JsonObject* Object;
+			const JsonArray* Array;
+			JsonObject::const_iterator Next;
+			std::vector<const Member*> Sorted;
+			size_t Index;
+			std::shared_ptr<const JsonTypedElements> Typed; // Written from the buffer of a typed array, without making the nodes
+		};
+		std::vector<Frame> Stack;
+
+		auto Open = [&](const JsonData& Value)
+		{
+			switch (Value.GetType())
+			{
+			case JsonDataType::Object:
+				{
+					auto& Object = static_cast<const JsonObject&>(Value);
+					Out += '{';
+					Frame Top{&Object, nullptr, Object.cbegin(), {}, 0, nullptr};
+					auto Unordered = std::adjacent_find(Object.cbegin(), Object.cend(), [](const Member& a, const Member& b) { return !Utf16Less(a.first, b.first); });
+					if (Unordered != Object.cend())
+					{
+						for (auto& m : Object) Top.Sorted.push_back(&m);
+						std::sort(Top.Sorted.begin(), Top.Sorted.end(), NameLess);
+					}
+					Stack.push_back(std::move(Top));
+					return;
+				}
+			case JsonDataType::Array:
+				{
+					auto& Array = static_cast<const JsonArray&>(Value);
+					Out += '[';
+					Stack.push_back(Frame{nullptr, &Array, JsonObject::const_iterator(), {}, 0, Array.ShareTypedElements()});
+					return;
+				}
+			case JsonDataType::String:
+				return AppendCanonicalString(Out, static_cast<const JsonString&>(Value));
+			case JsonDataType::Number:
+				return AppendCanonicalNumber(Out, static_cast<const JsonNumber&>(Value).Value);
+			case JsonDataType::Boolean:
+				Out += static_cast<const JsonBoolean&>(Value).Value ? "true" : "false";
+				return;
+			default:
+				Out += "null";
+				return;
+			}
+		};
+
+		Open(Json);
+		while (!Stack.empty())
+		{
+			if (Sink && Out.size() >= BufferSize)
+			{
+				(*Sink)(Out);
+				Out.clear();
+			}
+
+			auto& Top = Stack.back();
+			size_t Count = Top.Object ? Top.Object->size() : Top.Typed ? Top.Typed->size() : Top.Array->size();
+			if (Top.Index == Count)
+			{
+				Out += Top.Object ? '}' : ']';
+				Stack.pop_back();
+				continue;
+			}
+
+			if (Top.Index++) Out += ',';
+			if (Top.Typed)
+			{
+				// Integers too are numbers to the canonical form, written as their double
+				auto& Typed = *Top.Typed;
+				if (Typed.GetElementType() == JsonTypedElements::ElementType::Boolean) Out += Typed.GetBoolean(Top.Index - 1) ? "true" : "false";
+				else AppendCanonicalNumber(Out, Typed.GetNumber(Top.Index - 1));
+				continue;
+			}
+			const JsonData* Child;
+			if (Top.Object)
+			{
+				const Member& m = Top.Sorted.empty() ? *Top.Next++ : *Top.Sorted[Top.Index - 1];
+				AppendCanonicalString(Out, m.first);
+				Out += ':';
+				Child = m.second.get();
+			}
+			else Child = Top.Array->cbegin()[Top.Index - 1].get();
+			Open(*Child);
+		}
+		if (Sink && !Out.empty()) (*Sink)(Out);
+	}
+
+	std::string ToStringCanonical(const JsonData& Json)
+	{
+		std::string Out;
+		SerializeCanonical(Out, Json, nullptr, 0);
+		return Out;
+	}
+
+	void WriteJsonCanonical(const JsonData& Json, const std::function<void(std::string_view)>& Sink, size_t BufferSize)
+	{
+		std::string Buffer;
+		Buffer.reserve(BufferSize + 64);
+		SerializeCanonical(Buffer, Json, &Sink, BufferSize);
+	}
+
+	JsonWriteError::JsonWriteError(const std::string& what) noexcept :
+		std::runtime_error(what)
+	{
+	}
+
+	[[noreturn]] static void ThrowWriteError(const char* What, const std::string& FilePath, std::error_code Error = std::error_code(errno, std::generic_category()))
+	{
+		std::stringstream ss;
+		ss << What << " `" << FilePath << "`: " << Error.message();
+		throw JsonWriteError(ss.str());
+	}
+
+	// Collects output in a fixed buffer that is written to a file whenever it fills up
+	class JsonFileOutput
+	{
+	protected:
+		std::FILE* File;
+		std::string FilePath;
+		std::vector<char> Buffer;
+		size_t Used;
+		size_t Written;
+
+	public:
+		JsonFileOutput(const std::string& FilePath, size_t BufferSize) :
+			JsonFileOutput(std::fopen(FilePath.c_str(), "wb"), FilePath, BufferSize)
+		{
+		}
+
+		// Takes over File, opened for writing FilePath, or throws with errno for nullptr
+		JsonFileOutput(std::FILE* File, const std::string& FilePath, size_t BufferSize) :
+			File(Opened(File, FilePath)),
+			FilePath(FilePath),
+			Buffer(std::max<size_t>(BufferSize, 1)),
+			Used(0),
+			Written(0)
+		{
+			std::setvbuf(File, nullptr, _IONBF, 0);
+		}
+
+		// Before anything else is allocated, which could change errno
+		static std::FILE* Opened(std::FILE* File, const std::string& FilePath)
+		{
+			if (!File) ThrowWriteError("Could not create", FilePath);
+			return File;
+		}
+
+		~JsonFileOutput()
+		{
+			if (File) std::fclose(File);
+		}
+
+		void Flush()
+		{
+			if (Used && std::fwrite(Buffer.data(), 1, Used, File) != Used) ThrowWriteError("Could not write", FilePath);
+			Used = 0;
+		}
+
+		void Write(std::string_view s)
+		{
+			Written += s.size();
+			if (s.size() > Buffer.size() - Used)
+			{
+				Flush();
+				if (s.size() >= Buffer.size())
+				{
+					if (std::fwrite(s.data(), 1, s.size(), File) != s.size()) ThrowWriteError("Could not write", FilePath);
+					return;
+				}
+			}
+			memcpy(Buffer.data() + Used, s.data(), s.size());
+			Used += s.size();
+		}
+
+		void Close(bool Sync)
+		{
+			Flush();
+			if (Sync)
+			{
+#ifdef _WIN32
+				if (_commit(_fileno(File))) ThrowWriteError("Could not sync", FilePath);
+#else
+				if (fsync(fileno(File))) ThrowWriteError("Could not sync", FilePath);
+#endif
+			}
+			int Result = std::fclose(File);
+			File = nullptr;
+			if (Result) ThrowWriteError("Could not write", FilePath);
+		}
+
+		size_t GetWritten() const
+		{
+			return Written;
+		}
+	};
+
+	// Creates a file next to FilePath under a name no other file has, so concurrent writers of FilePath each get their own.
+	// The name is FilePath, a random 64-bit number in hex and ".tmp"; the exclusive open retries on a name that is taken.
+	static std::FILE* CreateTempFile(const std::string& FilePath, std::string& TempPath)
+	{
+		static std::atomic<uint64_t> Next((static_cast<uint64_t>(std::random_device()()) << 32) ^ std::random_device()());
+		for (int Attempt = 0;; Attempt++)
+		{
+			char Suffix[32];
+			snprintf(Suffix, sizeof Suffix, ".%016llx.tmp", static_cast<unsigned long long>(Next.fetch_add(0x9E3779B97F4A7C15ull)));
+			TempPath = FilePath + Suffix;
+			std::FILE* File = std::fopen(TempPath.c_str(), "wbx");
+			if (File) return File;
+			if (errno != EEXIST || Attempt == 99) ThrowWriteError("Could not create", TempPath);
+		}
+	}
+
+	// Gives the temporary file the permissions of the file it replaces, and its owner and group as far as the process may,
+	// rather than the defaults of a new file. Nothing to do when FilePath doesn't exist yet.
+	static void CopyFileAttributes(std::FILE* File, const std::string& FilePath, const std::string& TempPath)
+	{
+#ifdef _WIN32
+		std::error_code Error;
+		auto Status = std::filesystem::status(FilePath, Error);
+		if (Error || !std::filesystem::exists(Status)) return;
+		std::filesystem::permissions(TempPath, Status.permissions(), Error);
+		if (Error) ThrowWriteError("Could not set the permissions of", TempPath, Error);
+#else
+		struct stat Status;
+		if (stat(FilePath.c_str(), &Status)) return;
+		int fd = fileno(File);
+		// Only root may give a file away, and others only to a group they are in; EPERM leaves the defaults
+		if (fchown(fd, Status.st_uid, Status.st_gid) && fchown(fd, static_cast<uid_t>(-1), Status.st_gid) && errno != EPERM)
+			ThrowWriteError("Could not set the owner of", TempPath);
+		if (fchmod(fd, Status.st_mode & 07777)) ThrowWriteError("Could not set the permissions of", TempPath);
+#endif
+	}
+
+	// Creates the file as Options asks and calls Write with its output
+	template<typename Writer>
+	static void WriteJsonFile(const std::string& FilePath, const JsonWriteOptions& Options, Writer Write)
+	{
+		SerializeStatistics Stat;
+		std::string TempPath = FilePath;
+		std::FILE* File = Options.Atomic ? CreateTempFile(FilePath, TempPath) : std::fopen(FilePath.c_str(), "wb");
+		try
+		{
+			JsonFileOutput Out(File, TempPath, Options.BufferSize);
+			if (Options.Atomic) CopyFileAttributes(File, FilePath, TempPath);
+			Write(Out);
+			Out.Close(Options.Sync);
+			Stat.Finish(Out.GetWritten());
+		}
+		catch (...)
+		{
+			if (Options.Atomic)
+			{
+				std::error_code Ignored;
+				std::filesystem::remove(TempPath, Ignored);
+			}
+			throw;
+		}
+		if (!Options.Atomic) return;
+
+		std::error_code Error;
+		std::filesystem::rename(TempPath, FilePath, Error);
+		if (Error)
+		{
+			std::error_code Ignored;
+			std::filesystem::remove(TempPath, Ignored);
+			ThrowWriteError("Could not replace", FilePath, Error);
+		}
+#ifndef _WIN32
+		if (Options.Sync)
+		{
+			// Make the rename itself durable
+			auto Directory = std::filesystem::path(FilePath).parent_path();
+			if (Directory.empty()) Directory = ".";
+			int fd = open(Directory.c_str(), O_RDONLY);
+			if (fd < 0) ThrowWriteError("Could not open the directory of", FilePath);
+			int Result = fsync(fd);
+			std::error_code Error(errno, std::generic_category());
+			close(fd);
+			if (Result) ThrowWriteError("Could not sync the directory of", FilePath, Error);
+		}
+#endif
+	}
+
+	void WriteJsonToFile(const JsonData& Json, const std::string& FilePath, const JsonWriteOptions& Options)
+	{
+		WriteJsonFile(FilePath, Options, [&](JsonFileOutput& Out) { SerializeJson(Out, Json, Options.Indent, 0, Options.IndentType); });
+	}
+
+	void WriteJsonToFile(const JsonData& Json, const std::string& FilePath, const JsonWriteOptions& Options, const JsonParallelOptions& Parallel)
+	{
+		WriteJsonFile(FilePath, Options, [&](JsonFileOutput& Out)
+		{
+			WriteJsonParallel(Json, [&Out](std::string_view Chunk) { Out.Write(Chunk); }, Options.Indent, Options.IndentType, Parallel);
+		});
+	}
+
+	JsonObject::reverse_iterator JsonObject::rbegin()
+	{
+		Load();
+		return JsonObjectParentType::rbegin();
+	}
+
+	JsonObject::reverse_iterator JsonObject::rend()
+	{
+		Load();
+		return JsonObjectParentType::rend();
+	}
+
+	JsonObject::const_reverse_iterator JsonObject::rbegin() const
+	{
+		Load();
+		return JsonObjectParentType::rbegin();
+	}
+
+	JsonObject::const_reverse_iterator JsonObject::rend() const
+	{
+		Load();
+		return JsonObjectParentType::rend();
+	}
+
+	JsonObject::const_reverse_iterator JsonObject::crbegin() const
+	{
+		Load();
+		return JsonObjectParentType::crbegin();
+	}
+
+	JsonObject::const_reverse_iterator JsonObject::crend() const
+	{
+		Load();
+		return JsonObjectParentType::crend();
+	}
+
+	std::pair<JsonObject::iterator, bool> JsonObject::insert(value_type&& Value)
+	{
+		Invalidate();
+		return JsonObjectParentType::insert(std::move(Value));
+	}
+
+	void JsonObject::insert(std::initializer_list<value_type> List)
+	{
+		Invalidate();
+		JsonObjectParentType::insert(List);
+	}
+
+	JsonObject& JsonData::AsJsonObject()
+	{
+		auto p = dynamic_cast<JsonObject*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonArray& JsonData::AsJsonArray()
+	{
+		auto p = dynamic_cast<JsonArray*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonString& JsonData::AsJsonString()
+	{
+		auto p = dynamic_cast<JsonString*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON string, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonNumber& JsonData::AsJsonNumber()
+	{
+		auto p = dynamic_cast<JsonNumber*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonBoolean& JsonData::AsJsonBoolean()
+	{
+		auto p = dynamic_cast<JsonBoolean*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON boolean, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonObject& JsonData::AsJsonObject() const
+	{
+		auto p = dynamic_cast<const JsonObject*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonArray& JsonData::AsJsonArray() const
+	{
+		auto p = dynamic_cast<const JsonArray*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonString& JsonData::AsJsonString() const
+	{
+		auto p = dynamic_cast<const JsonString*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON string, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonNumber& JsonData::AsJsonNumber() const
+	{
+		auto p = dynamic_cast<const JsonNumber*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonBoolean& JsonData::AsJsonBoolean() const
+	{
+		auto p = dynamic_cast<const JsonBoolean*>(this);
+		if (p) return *p; else throw WrongDataType(LineNo, Column, std::string("Expected a JSON boolean, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonObject* JsonData::TryAsJsonObject()
+	{
+		return Type == JsonDataType::Object ? static_cast<JsonObject*>(this) : nullptr;
+	}
+
+	JsonArray* JsonData::TryAsJsonArray()
+	{
+		return Type == JsonDataType::Array ? static_cast<JsonArray*>(this) : nullptr;
+	}
+
+	JsonString* JsonData::TryAsJsonString()
+	{
+		return Type == JsonDataType::String ? static_cast<JsonString*>(this) : nullptr;
+	}
+
+	JsonNumber* JsonData::TryAsJsonNumber()
+	{
+		return Type == JsonDataType::Number ? static_cast<JsonNumber*>(this) : nullptr;
+	}
+
+	JsonBoolean* JsonData::TryAsJsonBoolean()
+	{
+		return Type == JsonDataType::Boolean ? static_cast<JsonBoolean*>(this) : nullptr;
+	}
+
+	const JsonObject* JsonData::TryAsJsonObject() const
+	{
+		return Type == JsonDataType::Object ? static_cast<const JsonObject*>(this) : nullptr;
+	}
+
+	const JsonArray* JsonData::TryAsJsonArray() const
+	{
+		return Type == JsonDataType::Array ? static_cast<const JsonArray*>(this) : nullptr;
+	}
+
+	const JsonString* JsonData::TryAsJsonString() const
+	{
+		return Type == JsonDataType::String ? static_cast<const JsonString*>(this) : nullptr;
+	}
+
+	const JsonNumber* JsonData::TryAsJsonNumber() const
+	{
+		return Type == JsonDataType::Number ? static_cast<const JsonNumber*>(this) : nullptr;
+	}
+
+	const JsonBoolean* JsonData::TryAsJsonBoolean() const
+	{
+		return Type == JsonDataType::Boolean ? static_cast<const JsonBoolean*>(this) : nullptr;
+	}
+
+	JsonData* JsonData::TryAt(std::string_view Key) const
+	{
+		auto Object = TryAsJsonObject();
+		if (!Object) return nullptr;
+		auto found = Object->find(Key);
+		return found != Object->cend() ? found->second.get() : nullptr;
+	}
+
+	JsonData* JsonData::TryAt(size_t Index) const
+	{
+		auto Array = TryAsJsonArray();
+		if (!Array || Index >= Array->size()) return nullptr;
+		return Array->at(Index).get();
+	}
+
+	bool JsonData::IsNull() const
+	{
+		auto p = dynamic_cast<const JsonNull*>(this);
+		return p ? true : false;
+	}
+
+	JsonDataPtr JsonData::ParseJson(const std::string& s, const JsonAllocatorType& Alloc)
+	{
+		return ParseJson(s, JsonParseOptions(), Alloc);
+	}
+
+	JsonDataPtr JsonData::ParseJson(const std::string& s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		auto Result = TryParseJson(s, Options, Alloc);
+		if (!Result) Result.Throw();
+		return std::move(Result.Value);
+	}
+
+	JsonParseResult JsonData::TryParseJson(const std::string& s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		// Deferred containers parse their members from a copy of the input too
+		if (Options.RetainSource || Options.LazyDepth != SIZE_MAX) return TryParseJson(std::make_shared<const std::string>(s), Options, Alloc);
+
+		JsonParser jp(s, Alloc);
+		jp.TrackPositions = Options.TrackPositions;
+		jp.AllowComments = Options.AllowComments;
+		jp.MaxDepth = Options.MaxDepth;
+		jp.LazyNumbers = Options.LazyNumbers;
+		jp.TypedArrays = Options.TypedArrays;
+		jp.LazyDepth = Options.LazyDepth;
+		jp.Stats.Begin(s.size());
+		return TryParseJson(jp);
+	}
+
+	JsonParseResult JsonData::TryParseJson(std::shared_ptr<const std::string> s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		JsonParser jp(*s, Alloc);
+		if (Options.RetainSource) jp.Source = s;
+		jp.LazyText = JsonSourceSpan(s, 0, s->size());
+		jp.TrackPositions = Options.TrackPositions;
+		jp.AllowComments = Options.AllowComments;
+		jp.MaxDepth = Options.MaxDepth;
+		jp.LazyNumbers = Options.LazyNumbers;
+		jp.TypedArrays = Options.TypedArrays;
+		jp.LazyDepth = Options.LazyDepth;
+		jp.Stats.Begin(s->size());
+		return TryParseJson(jp);
+	}
+
+	JsonParseResult JsonData::TryParseJsonFile(const std::string& FilePath, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		JsonParseResult Result;
+		if (Options.RetainSource || Options.LazyDepth != SIZE_MAX)
+		{
+			std::ifstream ifs(FilePath);
+			if (ifs.fail())
+			{
+				Result.Error = JsonErrorCode::CouldNotReadFile;
+				return Result;
+			}
+			// A read error lands on ifs when peeking and on ss while copying, which also fails for an empty file
+			std::stringstream ss;
+			if (ifs.peek() != std::ifstream::traits_type::eof()) ss << ifs.rdbuf();
+			if (ifs.bad() || ss.fail())
+			{
+				Result.Error = JsonErrorCode::CouldNotReadFile;
+				return Result;
+			}
+			return TryParseJson(std::make_shared<const std::string>(std::move(ss).str()), Options, Alloc);
+		}
+
+		JsonReadAhead Reader(FilePath, Options.ReadAheadBlockSize, Options.ReadAheadBlocks);
+		if (!Reader.IsOpen())
+		{
+			Result.Error = JsonErrorCode::CouldNotReadFile;
+			return Result;
+		}
+		JsonParser jp(std::string_view(), Alloc);
+		jp.SetReader(Reader);
+		jp.TrackPositions = Options.TrackPositions;
+		jp.AllowComments = Options.AllowComments;
+		jp.MaxDepth = Options.MaxDepth;
+		jp.LazyNumbers = Options.LazyNumbers;
+		jp.TypedArrays = Options.TypedArrays;
+		jp.LazyDepth = Options.LazyDepth;
+		jp.Stats.Begin(Reader.GetFileSize());
+		Result = TryParseJson(jp);
+
+		// An error reading the file cut the input short; whatever the parse made of that is not the file's content
+		if (Reader.ReadFailed())
+		{
+			Result = JsonParseResult();
+			Result.Error = JsonErrorCode::CouldNotReadFile;
+		}
+		return Result;
+	}
+
+#ifdef JSON_USE_PMR
+	JsonParseResult JsonData::TryParseJsonInSitu(JsonInSituResource& Resource, const JsonParseOptions& Options)
+	{
+		JsonParser jp(std::string_view(), JsonAllocatorType{ &Resource });
+		jp.SetInSitu(Resource.Buffer, Resource.Size);
+		jp.InSituResource = &Resource;
+		jp.TrackPositions = Options.TrackPositions;
+		jp.AllowComments = Options.AllowComments;
+		jp.MaxDepth = Options.MaxDepth;
+		jp.LazyNumbers = Options.LazyNumbers;
+		jp.TypedArrays = Options.TypedArrays;
+		jp.Stats.Begin(Resource.Size);
+
+		// A string that was being made when something threw must not hand its place to the next allocation
+		struct ExpectedScope
+		{
+			JsonInSituResource& Resource;
+			~ExpectedScope() { Resource.Expected = nullptr; }
+		} Scope{ Resource };
+		return TryParseJson(jp);
+	}
+#endif
+
+	JsonParseResult JsonData::TryParseJson(JsonParser& jp)
+	{
+		// Nothing but whitespace and comments gives no value rather than an error
+		JsonParseResult Result;
+		if (!jp.SkipSpacesAndComments()) return jp.GetErrorResult();
+		if (jp.End()) return Result;
+
+		Result.Value = ParseJson(jp);
+		if (jp.Failed() || !jp.SkipSpacesAndComments()) return jp.GetErrorResult();
+		if (!jp.End())
+		{
+			jp.Fail(JsonErrorCode::ExtraData, jp.Offset());
+			return jp.GetErrorResult();
+		}
+		jp.Stats.End();
+		return Result;
+	}
+
+	bool JsonData::operator ==(const JsonData& c) const
+	{
+		if (this == &c) return true;
+		if (Type != c.Type) return false;
+		switch (c.GetType())
+		{
+		case JsonDataType::Object:
+			return AsJsonObject() == c.AsJsonObject();
+		case JsonDataType::Array:
+			return AsJsonArray() == c.AsJsonArray();
+		case JsonDataType::String:
+			return AsJsonString() == c.AsJsonString();
+		case JsonDataType::Number:
+			return AsJsonNumber() == c.AsJsonNumber();
+		case JsonDataType::Boolean:
+			return AsJsonBoolean() == c.AsJsonBoolean();
+		case JsonDataType::Null:
+			return true; //  true
+		default:
+			throw WrongDataType(c.GetLineNo(), c.GetColumn(), "Unknown JSON data type.");
+			return false;
+		}
+	}
+
+	bool JsonData::operator !=(const JsonData& c) const
+	{
+		return !operator==(c);
+	}
+
+	// Whether a node equals an element of a typed array
+	static bool SameAsTyped(const JsonData& Node, const JsonTypedElements& Typed, size_t Index)
+	{
+		if (Typed.GetElementType() == JsonTypedElements::ElementType::Boolean) return Node.GetType() == JsonDataType::Boolean && Node.AsJsonBoolean().Value == Typed.GetBoolean(Index);
+		return Node.GetType() == JsonDataType::Number && Node.AsJsonNumber().Value == Typed.GetNumber(Index);
+	}
+
+	// Whether elements of two typed arrays are equal: booleans to booleans, numbers by value and integers exactly
+	static bool SameTyped(const JsonTypedElements& x, size_t i, const JsonTypedElements& y, size_t j)
+	{
+		using ElementType = JsonTypedElements::ElementType;
+		if ((x.GetElementType() == ElementType::Boolean) != (y.GetElementType() == ElementType::Boolean)) return false;
+		if (x.GetElementType() == ElementType::Integer && y.GetElementType() == ElementType::Integer) return x.GetInteger(i) == y.GetInteger(j);
+		return x.GetNumber(i) == y.GetNumber(j);
+	}
+
+	// Compares two trees from a list of the pairs of children still to compare rather than by recursion,
+	// so that deep documents don't exhaust the stack. Subtrees both share are equal without looking into them.
+	static bool SameTree(const JsonData& Left, const JsonData& Right)
+	{
+		std::vector<std::pair<const JsonData*, const JsonData*>> Pending{ { &Left, &Right } };
+		while (!Pending.empty())
+		{
+			auto [a, b] = Pending.back();
+			Pending.pop_back();
+			if (a == b) continue;
+			if (!a || !b || a->GetType() != b->GetType()) return false;
+			switch (a->GetType())
+			{
+			case JsonDataType::Object:
+			{
+				auto& x = a->AsJsonObject();
+				auto& y = b->AsJsonObject();
+
+				// һ
+				if (x.size() != y.size()) return false;
+
+				// ߵ key ģϼ
+				for (auto i = x.cbegin(), j = y.cbegin(); i != x.cend(); i++, j++)
+				{
+					// ÿ key һ
+					if (i->first != j->first) return false;
+
+					// ÿ Item ƥ
+					Pending.emplace_back(i->second.get(), j->second.get());
+				}
+				break;
+			}
+			case JsonDataType::Array:
+			{
+				auto& x = a->AsJsonArray();
+				auto& y = b->AsJsonArray();
+				if (x.size() != y.size()) return false;
+
+				// Typed arrays are compared from their buffers, without making the nodes
+				auto tx = x.ShareTypedElements(), ty = y.ShareTypedElements();
+				if (tx && ty)
+				{
+					for (size_t i = 0; i < tx->size(); i++)
+					{
+						if (!SameTyped(*tx, i, *ty, i)) return false;
+					}
+				}
+				else if (tx || ty)
+				{
+					auto& Typed = tx ? *tx : *ty;
+					auto& Other = tx ? y : x;
+					for (size_t i = 0; i < Typed.size(); i++)
+					{
+						if (!SameAsTyped(*Other.at(i), Typed, i)) return false;
+					}
+				}
+				else for (size_t i = 0; i < x.size(); i++) Pending.emplace_back(x.at(i).get(), y.at(i).get());
+				break;
+			}
+			default:
+				if (*a != *b) return false;
+				break;
+			}
+		}
+		return true;
+	}
+
+	bool JsonObject::operator ==(const JsonObject& c) const
+	{
+		return SameTree(*this, c);
+	}
+
+	bool JsonObject::operator !=(const JsonObject& c) const
+	{
+		return !operator==(c);
+	}
+
+	bool JsonArray::operator ==(const JsonArray& c) const
+	{
+		return SameTree(*this, c);
+	}
+
+	bool JsonArray::operator !=(const JsonArray& c) const
+	{
+		return !operator==(c);
+	}
+
+	bool JsonString::operator ==(const JsonString& c) const
+	{
+		return static_cast<const JsonStringParentType&>(*this) == static_cast<const JsonStringParentType&>(c);
+	}
+	bool JsonString::operator !=(const JsonString& c) const
+	{
+		return !operator==(c);
+	}
+
+	bool JsonNumber::operator ==(const JsonNumber& c) const
+	{
+		return Value == c.Value;
+	}
+	bool JsonNumber::operator !=(const JsonNumber& c) const
+	{
+		return !operator==(c);
+	}
+
+	bool JsonBoolean::operator ==(const JsonBoolean& c) const
+	{
+		return Value == c.Value;
+	}
+	bool JsonBoolean::operator !=(const JsonBoolean& c) const
+	{
+		return !operator==(c);
+	}
+
+	bool JsonNull::operator ==(const JsonNull& c) const
+	{
+		return true;
+	}
+	bool JsonNull::operator !=(const JsonNull& c) const
+	{
+		return !operator==(c);
+	}
+
+	JsonDataPtr& JsonData::operator [] (const std::string& key)
+	{
+		return operator [](JsonString(key, 0, 0));
+	}
+
+	const JsonDataPtr& JsonData::at(const std::string& key) const
+	{
+		return at(JsonString(key, 0, 0));
+	}
+
+	JsonData::operator JsonString () const
+	{
+		return JsonString(ToString(), LineNo, Column);
+	}
+
+	template<typename T>
+	JsonDataPtr& JsonObject::operator [] (T key)
+	{
+		Invalidate();
+		return JsonObjectParentType::operator[](JsonString(key, 0, 0));
+	}
+
+	template<typename T>
+	bool JsonObject::contains(T key) const
+	{
+		Load();
+		return JsonObjectParentType::contains(std::string_view(key));
+	}
+
+	template<typename T>
+	const JsonDataPtr& JsonObject::at(T key) const
+	{
+		Load();
+		auto found = JsonObjectParentType::find(std::string_view(key));
+		if (found == cend()) throw std::out_of_range("map::at");
+		return found->second;
+	}
+
+	template bool JsonObject::contains(const std::string& Key) const;
+	template const JsonDataPtr& JsonObject::at(const std::string& Key) const;
+	template JsonDataPtr& JsonObject::operator [] (const std::string& Key);
+
+	template bool JsonObject::contains(const char* Key) const;
+	template const JsonDataPtr& JsonObject::at(const char* Key) const;
+	template JsonDataPtr& JsonObject::operator [] (const char* Key);
+
+	template bool JsonObject::contains(std::string Key) const;
+	template const JsonDataPtr& JsonObject::at(std::string Key) const;
+	template JsonDataPtr& JsonObject::operator [] (std::string Key);
+
+	template bool JsonObject::contains(std::string_view Key) const;
+	template const JsonDataPtr& JsonObject::at(std::string_view Key) const;
+	template JsonDataPtr& JsonObject::operator [] (std::string_view Key);
+
+	JsonDataPtr& JsonObject::operator [] (const JsonString& Key)
+	{
+		Invalidate();
+		return JsonObjectParentType::operator[](Key);
+	}
+
+	const JsonDataPtr& JsonObject::at(const JsonString& Key) const
+	{
+		Load();
+		return JsonObjectParentType::at(Key);
+	}
+
+	bool JsonObject::contains(const JsonString& Key) const
+	{
+		Load();
+		return JsonObjectParentType::contains(Key);
+	}
+
+	JsonDataPtr& JsonObject::operator [] (size_t Index)
+	{
+		char buf[128];
+		snprintf(buf, sizeof buf, "%zu", Index);
+		return operator [](buf);
+	}
+
+	const JsonDataPtr& JsonObject::at(size_t Index) const
+	{
+		char buf[128];
+		snprintf(buf, sizeof buf, "%zu", Index);
+		return at(buf);
+	}
+
+	JsonObject::operator double() const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr& JsonArray::operator [] (const JsonString& Key)
+	{
+		return operator[](size_t(std::stoull(StdString(Key))));
+	}
+
+	JsonDataPtr& JsonArray::operator [] (const std::string& Key)
+	{
+		return operator[](size_t(std::stoull(Key)));
+	}
+
+	const JsonDataPtr& JsonArray::at(const std::string& Key) const
+	{
+		return at(size_t(std::stoull(Key)));
+	}
+
+	const JsonDataPtr& JsonArray::at(const JsonString& Key) const
+	{
+		return at(size_t(std::stoull(StdString(Key))));
+	}
+
+	bool JsonArray::contains(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr& JsonArray::operator [] (size_t Index)
+	{
+		Invalidate();
+		return JsonArrayParentType::operator[](Index);
+	}
+
+	const JsonDataPtr& JsonArray::at(size_t Index) const
+	{
+		Load();
+		return JsonArrayParentType::at(Index);
+	}
+
+	JsonArray::operator double() const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr& JsonString::operator [] (const JsonString& Key)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonString::at(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	bool JsonString::contains(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr& JsonString::operator [] (size_t Index)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonString::at(size_t Index) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonString::operator double() const
+	{
+		return std::stod(StdString(*this));
+	}
+
+	JsonDataPtr& JsonNumber::operator [] (const JsonString& Key)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonNumber::at(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	bool JsonNumber::contains(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr& JsonNumber::operator [] (size_t Index)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonNumber::at(size_t Index) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonNumber::operator double() const
+	{
+		return Value;
+	}
+
+	JsonDataPtr& JsonBoolean::operator [] (const JsonString& Key)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonBoolean::at(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	bool JsonBoolean::contains(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr& JsonBoolean::operator [] (size_t Index)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonBoolean::at(size_t Index) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonBoolean::operator double() const
+	{
+		return Value ? 1.0 : 0.0;
+	}
+
+	JsonDataPtr& JsonNull::operator [] (const JsonString& Key)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonNull::at(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	bool JsonNull::contains(const JsonString& Key) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON object, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr& JsonNull::operator [] (size_t Index)
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	const JsonDataPtr& JsonNull::at(size_t Index) const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON array, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonNull::operator double() const
+	{
+		throw WrongDataType(LineNo, Column, std::string("Expected a JSON number, got a JSON ") + JsonDataTypeToString(Type));
+	}
+
+	JsonDataPtr ParseJson(const std::string& s)
+	{
+		return JsonData::ParseJson(s);
+	}
+
+	JsonDataPtr ParseJsonFromString(const std::string& s, const JsonAllocatorType& Alloc)
+	{
+		return JsonData::ParseJson(s, Alloc);
+	}
+
+	[[noreturn]] static void ThrowCouldNotRead(const std::string& FilePath)
+	{
+		std::stringstream ss;
+		ss << "Could not read `" << FilePath << "`";
+		throw JsonDecodeError(0, 0, ss.str());
+	}
+
+	JsonDataPtr ParseJsonFromFile(const std::string& FilePath, const JsonAllocatorType& Alloc)
+	{
+		return ParseJsonFromFile(FilePath, JsonParseOptions(), Alloc);
+	}
+
+	JsonDataPtr ParseJsonFromString(const std::string& s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		return JsonData::ParseJson(s, Options, Alloc);
+	}
+
+	JsonParseResult ValidateJson(std::string_view s, const JsonValidateOptions& Options)
+	{
+		JsonParser jp(s);
+		jp.AllowComments = Options.AllowComments;
+		if (Options.MaxSize && s.size() > Options.MaxSize)
+		{
+			jp.Fail(JsonErrorCode::TooLarge, Options.MaxSize);
+			return jp.GetErrorResult();
+		}
+
+		JsonParseResult Result;
+		if (!jp.SkipSpacesAndComments()) return jp.GetErrorResult();
+		if (jp.End()) return Result;
+		JsonNullHandler Handler;
+		if (!jp.Scan(Handler, Options.MaxDepth) || !jp.SkipSpacesAndComments()) return jp.GetErrorResult();
+		if (!jp.End())
+		{
+			jp.Fail(JsonErrorCode::ExtraData, jp.Offset());
+			return jp.GetErrorResult();
+		}
+		return Result;
+	}
+
+	JsonParseResult TryParseJsonFromString(const std::string& s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		return JsonData::TryParseJson(s, Options, Alloc);
+	}
+
+	JsonParseResult TryParseJsonFromString(std::shared_ptr<const std::string> s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		return JsonData::TryParseJson(std::move(s), Options, Alloc);
+	}
+
+	JsonParseResult TryParseJsonFromFile(const std::string& FilePath, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		return JsonData::TryParseJsonFile(FilePath, Options, Alloc);
+	}
+
+#ifdef JSON_USE_PMR
+	JsonInSituResource::JsonInSituResource(char* Buffer, size_t Size, std::pmr::memory_resource* Upstream) :
+		Buffer(Buffer),
+		Size(Size),
+		Upstream(Upstream),
+		Expected(nullptr),
+		ExpectedBytes(0)
+	{
+	}
+
+	// The characters of a string the parser is making are the only allocation of exactly their size with the alignment of char;
+	// the size has to match, since a string may be handed no more room than its text and terminator take
+	void* JsonInSituResource::do_allocate(size_t Bytes, size_t Alignment)
+	{
+		if (Expected && Bytes == ExpectedBytes && Alignment == alignof(char))
+		{
+			void* p = Expected;
+			Expected = nullptr;
+			return p;
+		}
+		return Upstream->allocate(Bytes, Alignment);
+	}
+
+	void JsonInSituResource::do_deallocate(void* p, size_t Bytes, size_t Alignment)
+	{
+		auto c = static_cast<char*>(p);
+		if (c >= Buffer && c < Buffer + Size) return;
+		Upstream->deallocate(p, Bytes, Alignment);
+	}
+
+	bool JsonInSituResource::do_is_equal(const std::pmr::memory_resource& Other) const noexcept
+	{
+		return this == &Other;
+	}
+
+	JsonDataPtr ParseJsonInSitu(JsonInSituResource& Resource, const JsonParseOptions& Options)
+	{
+		auto Result = JsonData::TryParseJsonInSitu(Resource, Options);
+		if (!Result) Result.Throw();
+		return std::move(Result.Value);
+	}
+
+	JsonParseResult TryParseJsonInSitu(JsonInSituResource& Resource, const JsonParseOptions& Options)
+	{
+		return JsonData::TryParseJsonInSitu(Resource, Options);
+	}
+#endif
+
+#ifdef JSON_USE_PMR
+	// The pool of a JsonReusableParser made with PoolNodes. Builds without NDEBUG check the rules that come with it
+	// not being thread-safe: one thread makes and destroys the documents, and none is left when the parser goes.
+	class JsonParserPool : public std::pmr::memory_resource
+	{
+	protected:
+		std::pmr::unsynchronized_pool_resource Pool;
+#ifndef NDEBUG
+		std::thread::id Owner; // Of the first allocation
+		size_t Outstanding = 0;
+
+		void CheckThread()
+		{
+			if (Owner == std::thread::id()) Owner = std::this_thread::get_id();
+			assert(Owner == std::this_thread::get_id() && "documents of a pooled JsonReusableParser must stay on one thread");
+		}
+#endif
+
+		void* do_allocate(size_t Bytes, size_t Alignment) override
+		{
+#ifndef NDEBUG
+			CheckThread();
+			Outstanding += Bytes;
+#endif
+			return Pool.allocate(Bytes, Alignment);
+		}
+
+		void do_deallocate(void* p, size_t Bytes, size_t Alignment) override
+		{
+#ifndef NDEBUG
+			CheckThread();
+			Outstanding -= Bytes;
+#endif
+			Pool.deallocate(p, Bytes, Alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& Other) const noexcept override
+		{
+			return this == &Other;
+		}
+
+	public:
+		~JsonParserPool()
+		{
+			assert(Outstanding == 0 && "a document of a pooled JsonReusableParser outlived it");
+		}
+	};
+#endif
+
+	JsonReusableParser::JsonReusableParser(const JsonParseOptions& Options, size_t MaxRetainedBytes, const JsonAllocatorType& Alloc) :
+		Parser(std::make_unique<JsonParser>(std::string_view(), Alloc)),
+		Options(Options),
+		MaxRetainedBytes(MaxRetainedBytes)
+	{
+	}
+
+#ifdef JSON_USE_PMR
+	JsonReusableParser::JsonReusableParser(const JsonParseOptions& Options, size_t MaxRetainedBytes, bool PoolNodes) :
+		Pool(PoolNodes ? std::make_unique<JsonParserPool>() : nullptr),
+		Parser(std::make_unique<JsonParser>(std::string_view(), Pool ? JsonAllocatorType(Pool.get()) : JsonAllocatorType())),
+		Options(Options),
+		MaxRetainedBytes(MaxRetainedBytes)
+	{
+	}
+#endif
+
+	JsonReusableParser::~JsonReusableParser() = default;
+
+	JsonDataPtr JsonReusableParser::Parse(std::string_view s)
+	{
+		auto Result = TryParse(s);
+		if (!Result) Result.Throw();
+		return std::move(Result.Value);
+	}
+
+	JsonParseResult JsonReusableParser::TryParse(std::string_view s)
+	{
+		// Deferred containers parse their members from a copy of the input too
+		if (Options.RetainSource || Options.LazyDepth != SIZE_MAX) return TryParse(std::make_shared<const std::string>(s));
+		return Run(s, nullptr);
+	}
+
+	JsonParseResult JsonReusableParser::TryParse(std::shared_ptr<const std::string> s)
+	{
+		std::string_view Text(*s);
+		return Run(Text, std::move(s));
+	}
+
+	JsonParseResult JsonReusableParser::Run(std::string_view s, std::shared_ptr<const std::string> Source)
+	{
+		auto& jp = *Parser;
+		jp.Reset(s);
+		if (Options.RetainSource) jp.Source = Source;
+		if (Source) jp.LazyText = JsonSourceSpan(Source, 0, Source->size());
+		jp.TrackPositions = Options.TrackPositions;
+		jp.AllowComments = Options.AllowComments;
+		jp.MaxDepth = Options.MaxDepth;
+		jp.LazyNumbers = Options.LazyNumbers;
+		jp.TypedArrays = Options.TypedArrays;
+		jp.LazyDepth = Options.LazyDepth;
+		jp.Stats.Begin(s.size());
+		auto Result = JsonData::TryParseJson(jp);
+		// The documents keep the input alive on their own, if they need it
+		jp.Source.reset();
+		jp.LazyText.reset();
+		jp.Trim(MaxRetainedBytes);
+		return Result;
+	}
+
+	JsonParseResult::JsonParseResult() :
+		Error(JsonErrorCode::None),
+		Offset(0),
+		LineNo(0),
+		Column(0),
+		Character(0)
+	{
+	}
+
+	JsonParseResult::operator bool() const
+	{
+		return Error == JsonErrorCode::None;
+	}
+
+	static const char* JsonSchemaKeywordName(JsonSchemaKeyword Keyword)
+	{
+		switch (Keyword)
+		{
+		case JsonSchemaKeyword::None: break;
+		case JsonSchemaKeyword::False: return "false";
+		case JsonSchemaKeyword::Type: return "type";
+		case JsonSchemaKeyword::Enum: return "enum";
+		case JsonSchemaKeyword::Const: return "const";
+		case JsonSchemaKeyword::Minimum: return "minimum";
+		case JsonSchemaKeyword::Maximum: return "maximum";
+		case JsonSchemaKeyword::ExclusiveMinimum: return "exclusiveMinimum";
+		case JsonSchemaKeyword::ExclusiveMaximum: return "exclusiveMaximum";
+		case JsonSchemaKeyword::MinLength: return "minLength";
+		case JsonSchemaKeyword::MaxLength: return "maxLength";
+		case JsonSchemaKeyword::Pattern: return "pattern";
+		case JsonSchemaKeyword::MinItems: return "minItems";
+		case JsonSchemaKeyword::MaxItems: return "maxItems";
+		case JsonSchemaKeyword::MinProperties: return "minProperties";
+		case JsonSchemaKeyword::MaxProperties: return "maxProperties";
+		case JsonSchemaKeyword::Required: return "required";
+		case JsonSchemaKeyword::AdditionalProperties: return "additionalProperties";
+		}
+		return "unknown";
+	}
+
+	std::string JsonParseResult::GetMessage() const
+	{
+		std::stringstream ss;
+		switch (Error)
+		{
+		case JsonErrorCode::None: return "";
+		case JsonErrorCode::UnexpectedEnd: return "Unexpected end of data";
+		case JsonErrorCode::UnexpectedCharacter:
+			ss << "Unexpected '" << Utf8Parser::EncodeUnicode(Character) << "'";
+			return ss.str();
+		case JsonErrorCode::InvalidUtf8: return Utf8ErrorMessage(static_cast<uint8_t>(Character), false);
+		case JsonErrorCode::TruncatedUtf8: return Utf8ErrorMessage(static_cast<uint8_t>(Character), true);
+		case JsonErrorCode::InvalidControlCharacter: return "Invalid control character";
+		case JsonErrorCode::InvalidEscape: return "Invalid \\escape";
+		case JsonErrorCode::ExpectedDigit: return "Expected digit";
+		case JsonErrorCode::NumberOutOfRange: return "Number out of range";
+		case JsonErrorCode::InvalidLiteral:
+			ss << "Error when decoding " << (Character == 't' ? "true" : Character == 'f' ? "false" : "null");
+			return ss.str();
+		case JsonErrorCode::KeyMustBeString: return "Key name must be string";
+		case JsonErrorCode::ExpectedColon: return "No ':' found";
+		case JsonErrorCode::UnterminatedComment: return "Expected */";
+		case JsonErrorCode::ExtraData: return "Unexpected extra data";
+		case JsonErrorCode::CouldNotReadFile: return "Could not read the file";
+		case JsonErrorCode::TooDeep: return "Nested too deeply";
+		case JsonErrorCode::TooLarge: return "Input too large";
+		case JsonErrorCode::SchemaViolation:
+			ss << "Does not match the schema (" << JsonSchemaKeywordName(static_cast<JsonSchemaKeyword>(Character)) << ")";
+			return ss.str();
+		}
+		return "Unknown error";
+	}
+
+	void JsonParseResult::Throw() const
+	{
+		switch (Error)
+		{
+		case JsonErrorCode::InvalidUtf8:
+		case JsonErrorCode::TruncatedUtf8:
+			throw UnicodeDecodeError(LineNo, Column, GetMessage());
+		default:
+			throw JsonDecodeError(LineNo, Column, GetMessage());
+		}
+	}
+
+	JsonDataPtr ParseJsonFromFile(const std::string& FilePath, const JsonParseOptions& Options, const JsonAllocatorType& Alloc)
+	{
+		auto Result = JsonData::TryParseJsonFile(FilePath, Options, Alloc);
+		if (Result.Error == JsonErrorCode::CouldNotReadFile) ThrowCouldNotRead(FilePath);
+		if (!Result) Result.Throw();
+		return std::move(Result.Value);
+	}
+
+	JsonDataPtr Copy(JsonDataPtr Json)
+	{
+		return Copy(*Json);
+	}
+
+	JsonDataPtr Copy(const JsonData& Json)
+	{
+		return Json.Copy();
+	}
+
+	JsonDataPtr JsonObject::Copy() const
+	{
+		return MakeJsonObjectPtr(*this);
+	}
+
+	JsonDataPtr JsonArray::Copy() const
+	{
+		return MakeJsonArrayPtr(*this);
+	}
+
+	JsonDataPtr JsonSourceObject::Copy() const
+	{
+		return MakeJsonPtr<JsonSourceObject>(*this);
+	}
+
+	JsonDataPtr JsonSourceArray::Copy() const
+	{
+		return MakeJsonPtr<JsonSourceArray>(*this);
+	}
+
+	JsonDataPtr JsonString::Copy() const
+	{
+		return MakeJsonStringPtr(*this);
+	}
+
+	JsonDataPtr JsonNumber::Copy() const
+	{
+		return MakeJsonNumberPtr(*this);
+	}
+
+	JsonDataPtr JsonLazyNumber::Copy() const
+	{
+		return MakeJsonPtr<JsonLazyNumber>(*this);
+	}
+
+	JsonDataPtr JsonBoolean::Copy() const
+	{
+		return MakeJsonBooleanPtr(*this);
+	}
+
+	JsonDataPtr JsonNull::Copy() const
+	{
+		return MakeJsonNullPtr(*this);
+	}
+
+	static size_t HashCombine(size_t Seed, size_t Value)
+	{
+		return Seed ^ (Value + 0x9E3779B97F4A7C15ull + (Seed << 6) + (Seed >> 2));
+	}
+
+	static size_t HashString(std::string_view s)
+	{
+		return HashCombine(static_cast<size_t>(JsonDataType::String), std::hash<std::string_view>()(s));
+	}
+
+	static size_t HashNumber(double v)
+	{
+		if (v == 0) v = 0; // -0.0 == 0.0
+		return HashCombine(static_cast<size_t>(JsonDataType::Number), std::hash<double>()(v));
+	}
+
+	static size_t HashBoolean(bool v)
+	{
+		return HashCombine(static_cast<size_t>(JsonDataType::Boolean), v ? 1 : 0);
+	}
+
+	// Hash() of a typed array: the one its nodes would give
+	static size_t HashTyped(const JsonTypedElements& Typed)
+	{
+		bool Booleans = Typed.GetElementType() == JsonTypedElements::ElementType::Boolean;
+		size_t h = HashCombine(static_cast<size_t>(JsonDataType::Array), Typed.size());
+		for (size_t i = 0; i < Typed.size(); i++) h = HashCombine(h, Booleans ? HashBoolean(Typed.GetBoolean(i)) : HashNumber(Typed.GetNumber(i)));
+		return h;
+	}
+
+	// Hash() of a tree, combined bottom-up from a stack of the containers being hashed rather than by recursion.
+	// A container starts from its type and size; an object adds the name and the hash of each member, an array those of its elements.
+	static size_t HashTree(const JsonData& Json)
+	{
+		struct Frame
+		{
+			const JsonData* Container;
+			size_t Hash;
+			JsonObject::const_iterator Member;
+			size_t Index;
+		};
+		std::vector<Frame> Stack;
+
+		// Hashes a value into Hash, or pushes it if it has children to hash first
+		auto Open = [&](const JsonData& Value, size_t& Hash)
+		{
+			switch (Value.GetType())
+			{
+			case JsonDataType::Object:
+				Stack.push_back(Frame{&Value, HashCombine(static_cast<size_t>(JsonDataType::Object), Value.AsJsonObject().size()), Value.AsJsonObject().cbegin(), 0});
+				return false;
+			case JsonDataType::Array:
+				if (auto Typed = Value.AsJsonArray().ShareTypedElements())
+				{
+					Hash = HashTyped(*Typed);
+					return true;
+				}
+				Stack.push_back(Frame{&Value, HashCombine(static_cast<size_t>(JsonDataType::Array), Value.AsJsonArray().size()), {}, 0});
+				return false;
+			default:
+				Hash = Value.Hash();
+				return true;
+			}
+		};
+
+		size_t Hash;
+		if (Open(Json, Hash)) return Hash;
+		for (;;)
+		{
+			auto& Top = Stack.back();
+			const JsonData* Child = nullptr;
+			if (Top.Container->GetType() == JsonDataType::Object)
+			{
+				if (Top.Member != Top.Container->AsJsonObject().cend())
+				{
+					Top.Hash = HashCombine(Top.Hash, HashString(Top.Member->first));
+					Child = Top.Member++->second.get();
+				}
+			}
+			else if (Top.Index < Top.Container->AsJsonArray().size()) Child = Top.Container->AsJsonArray().cbegin()[Top.Index++].get();
+
+			if (!Child)
+			{
+				// Done with the container on top, which adds to the one below it
+				Hash = Top.Hash;
+				Stack.pop_back();
+				if (Stack.empty()) return Hash;
+				Stack.back().Hash = HashCombine(Stack.back().Hash, Hash);
+			}
+			else if (Open(*Child, Hash)) Top.Hash = HashCombine(Top.Hash, Hash);
+		}
+	}
+
+	size_t JsonObject::Hash() const
+	{
+		return HashTree(*this);
+	}
+
+	size_t JsonArray::Hash() const
+	{
+		return HashTree(*this);
+	}
+
+	size_t JsonString::Hash() const
+	{
+		return HashString(*this);
+	}
+
+	size_t JsonNumber::Hash() const
+	{
+		return HashNumber(Value);
+	}
+
+	size_t JsonBoolean::Hash() const
+	{
+		return HashBoolean(Value);
+	}
+
+	size_t JsonNull::Hash() const
+	{
+		return static_cast<size_t>(JsonDataType::Null);
+	}
+
+	// Equality of two nodes whose children are interned already: equal children are the same node then.
+	// Numbers are compared bitwise, so 0 and -0 are kept apart and serialize as before.
+	static bool SameInterned(const JsonData& a, const JsonData& b)
+	{
+		if (a.GetType() != b.GetType()) return false;
+		switch (a.GetType())
+		{
+		case JsonDataType::Object:
+			{
+				auto& x = a.AsJsonObject();
+				auto& y = b.AsJsonObject();
+				if (x.size() != y.size()) return false;
+				for (auto i = x.cbegin(), j = y.cbegin(); i != x.cend(); i++, j++)
+				{
+					if (i->first != j->first || i->second != j->second) return false;
+				}
+				return true;
+			}
+		case JsonDataType::Array:
+			{
+				auto& x = a.AsJsonArray();
+				auto& y = b.AsJsonArray();
+				if (x.size() != y.size()) return false;
+
+				// Typed arrays only match typed ones, bitwise like numbers
+				auto tx = x.ShareTypedElements(), ty = y.ShareTypedElements();
+				if (tx || ty)
+				{
+					if (!tx || !ty || tx->GetElementType() != ty->GetElementType() || tx->size() != ty->size()) return false;
+					if (tx->GetElementType() == JsonTypedElements::ElementType::Integer) return std::ranges::equal(tx->GetIntegers(), ty->GetIntegers());
+					return !memcmp(tx->GetNumbers().data(), ty->GetNumbers().data(), tx->size() * sizeof(double));
+				}
+				for (size_t i = 0; i < x.size(); i++)
+				{
+					if (x.at(i) != y.at(i)) return false;
+				}
+				return true;
+			}
+		case JsonDataType::Number:
+			{
+				// A kept literal is written out as it is, so two spellings of a number stay apart
+				auto& x = a.AsJsonNumber();
+				auto& y = b.AsJsonNumber();
+				return !memcmp(&x.Value, &y.Value, sizeof(double)) && x.GetLiteral() == y.GetLiteral();
+			}
+		default:
+			return a == b;
+		}
+	}
+
+	JsonDataPtr JsonDeduplicator::Intern(const JsonDataPtr& Json, size_t Hash)
+	{
+		auto Range = Nodes.equal_range(Hash);
+		for (auto it = Range.first; it != Range.second; it++)
+		{
+			if (SameInterned(*it->second, *Json)) return it->second;
+		}
+		Nodes.emplace(Hash, Json);
+		return Json;
+	}
+
+	// Interns the children of each container before the container itself, from a stack rather than by recursion.
+	// The hash of a container is put together as Hash() would from the hashes its children were interned with.
+	JsonDataPtr JsonDeduplicator::Deduplicate(const JsonDataPtr& Json)
+	{
+		if (!Json) return Json;
+
+		struct Frame
+		{
+			JsonDataPtr Container;
+			JsonDataPtr* Slot; // Where the container sits in its parent, nullptr for the root
+			size_t Hash;
+			JsonObject::iterator Member;
+			size_t Index;
+		};
+		std::vector<Frame> Stack;
+
+		// Interns a value into Slot and gives its hash, or pushes it if its children come first
+		auto Open = [&](const JsonDataPtr& Value, JsonDataPtr* Slot, size_t& Hash)
+		{
+			switch (Value->GetType())
+			{
+			case JsonDataType::Object:
+				Stack.push_back(Frame{Value, Slot, HashCombine(static_cast<size_t>(JsonDataType::Object), Value->AsJsonObject().size()), Value->AsJsonObject().begin(), 0});
+				return false;
+			case JsonDataType::Array:
+				// A typed array has no nodes to intern, and making them would undo the buffer
+				if (!Value->AsJsonArray().ShareTypedElements())
+				{
+					Stack.push_back(Frame{Value, Slot, HashCombine(static_cast<size_t>(JsonDataType::Array), Value->AsJsonArray().size()), {}, 0});
+					return false;
+				}
+				[[fallthrough]];
+			default:
+				Hash = Value->Hash();
+				if (Slot) *Slot = Intern(Value, Hash);
+				return true;
+			}
+		};
+
+		size_t Hash;
+		if (Open(Json, nullptr, Hash)) return Intern(Json, Hash);
+		for (;;)
+		{
+			auto& Top = Stack.back();
+			JsonDataPtr* Slot = nullptr;
+			if (Top.Container->GetType() == JsonDataType::Object)
+			{
+				auto& Object = Top.Container->AsJsonObject();
+				if (Top.Member != Object.end())
+				{
+					Top.Hash = HashCombine(Top.Hash, HashString(Top.Member->first));
+					Slot = &Top.Member++->second;
+				}
+			}
+			else
+			{
+				auto& Array = Top.Container->AsJsonArray();
+				if (Top.Index < Array.size()) Slot = &Array.begin()[Top.Index++];
+			}
+
+			if (!Slot)
+			{
+				auto Done = std::move(Top);
+				Stack.pop_back();
+				auto Interned = Intern(Done.Container, Done.Hash);
+				if (!Done.Slot) return Interned;
+				*Done.Slot = std::move(Interned);
+				Stack.back().Hash = HashCombine(Stack.back().Hash, Done.Hash);
+			}
+			else if (Open(*Slot, Slot, Hash)) Top.Hash = HashCombine(Top.Hash, Hash);
+		}
+	}
+
+	size_t JsonDeduplicator::size() const
+	{
+		return Nodes.size();
+	}
+
+	void JsonDeduplicator::clear()
+	{
+		Nodes.clear();
+	}
+
+	JsonDataPtr Deduplicate(const JsonDataPtr& Json)
+	{
+		JsonDeduplicator Dedup;
+		return Dedup.Deduplicate(Json);
+	}
+
+	// Appends "/Token" to a JSON Pointer, escaping '~' and '/'
+	static void AppendPointerToken(std::string& Path, std::string_view Token)
+	{
+		Path += '/';
+		for (auto ch : Token)
+		{
+			switch (ch)
+			{
+			case '~': Path += "~0"; break;
+			case '/': Path += "~1"; break;
+			default: Path += ch; break;
+			}
+		}
+	}
+
+	std::vector<JsonDiffEntry> DiffJson(const JsonDataPtr& Old, const JsonDataPtr& New)
+	{
+		std::vector<JsonDiffEntry> Diff;
+		std::string Path;
+
+		// Objects or arrays on both sides being compared member by member, each with the length of its path
+		struct Frame
+		{
+			const JsonData* Old;
+			const JsonData* New;
+			size_t PathLength;
+			JsonObject::const_iterator OldMember;
+			JsonObject::const_iterator NewMember;
+			size_t Index;
+			std::shared_ptr<const JsonTypedElements> OldTyped;
+			std::shared_ptr<const JsonTypedElements> NewTyped;
+		};
+		std::vector<Frame> Stack;
+
+		// Records two values that differ at Path, or pushes them when they are containers to look into
+		auto Compare = [&](const JsonDataPtr& a, const JsonDataPtr& b)
+		{
+			if (a == b) return;
+			if (!a || !b || a->GetType() != b->GetType()) return Diff.push_back({ Path, a, b });
+			switch (a->GetType())
+			{
+			case JsonDataType::Object:
+				return Stack.push_back(Frame{a.get(), b.get(), Path.size(), a->AsJsonObject().cbegin(), b->AsJsonObject().cbegin(), 0, nullptr, nullptr});
+			case JsonDataType::Array:
+				return Stack.push_back(Frame{a.get(), b.get(), Path.size(), {}, {}, 0, a->AsJsonArray().ShareTypedElements(), b->AsJsonArray().ShareTypedElements()});
+			default:
+				if (*a != *b) Diff.push_back({ Path, a, b });
+				return;
+			}
+		};
+
+		// Typed arrays are compared from their buffers; only the elements in entries get a node
+		auto Element = [](const JsonData& a, const std::shared_ptr<const JsonTypedElements>& t, size_t i) -> JsonDataPtr
+		{
+			if (!t) return a.AsJsonArray().at(i);
+			return t->MakeNode(i, JsonAllocatorType());
+		};
+
+		Compare(Old, New);
+		while (!Stack.empty())
+		{
+			auto& Top = Stack.back();
+			Path.resize(Top.PathLength);
+			if (Top.Old->GetType() == JsonDataType::Object)
+			{
+				auto& x = Top.Old->AsJsonObject();
+				auto& y = Top.New->AsJsonObject();
+				auto& i = Top.OldMember;
+				auto& j = Top.NewMember;
+				if (i == x.cend() && j == y.cend())
+				{
+					Stack.pop_back();
+					continue;
+				}
+				if (j == y.cend() || (i != x.cend() && i->first < j->first))
+				{
+					AppendPointerToken(Path, i->first);
+					Diff.push_back({ Path, i->second, nullptr });
+					i++;
+				}
+				else if (i == x.cend() || j->first < i->first)
+				{
+					AppendPointerToken(Path, j->first);
+					Diff.push_back({ Path, nullptr, j->second });
+					j++;
+				}
+				else
+				{
+					AppendPointerToken(Path, i->first);
+					auto& a = i++->second;
+					auto& b = j++->second;
+					Compare(a, b); // May push, which moves Top
+				}
+				continue;
+			}
+
+			auto& x = Top.Old->AsJsonArray();
+			auto& y = Top.New->AsJsonArray();
+			auto& tx = Top.OldTyped;
+			auto& ty = Top.NewTyped;
+			size_t i = Top.Index++;
+			if (i >= std::max(x.size(), y.size()))
+			{
+				Stack.pop_back();
+				continue;
+			}
+			AppendPointerToken(Path, std::to_string(i));
+			if (i >= y.size()) Diff.push_back({ Path, Element(x, tx, i), nullptr });
+			else if (i >= x.size()) Diff.push_back({ Path, nullptr, Element(y, ty, i) });
+			else if (!tx && !ty) Compare(x.at(i), y.at(i));
+			else
+			{
+				bool Same;
+				if (tx && ty) Same = SameTyped(*tx, i, *ty, i);
+				else if (tx) Same = SameAsTyped(*y.at(i), *tx, i);
+				else Same = SameAsTyped(*x.at(i), *ty, i);
+				if (!Same) Diff.push_back({ Path, Element(x, tx, i), Element(y, ty, i) });
+			}
+		}
+		return Diff;
+	}
+
+	JsonCowRef::JsonCowRef(JsonDataPtr& Slot) :
+		Slot(Slot)
+	{
+	}
+
+	JsonData& JsonCowRef::Unshare()
+	{
+		if (!Slot) throw std::out_of_range("Empty JSON slot");
+		if (Slot.use_count() > 1) Slot = Slot->Copy();
+		return *Slot;
+	}
+
+	JsonCowRef JsonCowRef::operator [] (std::string_view Key)
+	{
+		return JsonCowRef(Unshare()[JsonString(Key, 0, 0)]);
+	}
+
+	JsonCowRef JsonCowRef::operator [] (size_t Index)
+	{
+		return JsonCowRef(Unshare()[Index]);
+	}
+
+	JsonCowRef& JsonCowRef::operator = (JsonDataPtr Value)
+	{
+		Slot = std::move(Value);
+		return *this;
+	}
+
+	JsonData& JsonCowRef::operator * ()
+	{
+		return Unshare();
+	}
+
+	JsonData* JsonCowRef::operator -> ()
+	{
+		return &Unshare();
+	}
+
+	JsonCowRef::operator JsonConstDataPtr () const
+	{
+		return Slot;
+	}
+
+	JsonCowDocument::JsonCowDocument(JsonDataPtr Root) :
+		Published(Root),
+		Working(Root)
+	{
+	}
+
+	JsonConstDataPtr JsonCowDocument::Snapshot() const
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		return Published;
+	}
+
+	void JsonCowDocument::Commit()
+	{
+		std::lock_guard<std::mutex> Guard(Lock);
+		Published = Working;
+	}
+
+	JsonCowRef JsonCowDocument::Root()
+	{
+		return JsonCowRef(Working);
+	}
+
+	JsonCowRef JsonCowDocument::operator [] (std::string_view Key)
+	{
+		return Root()[Key];
+	}
+
+	JsonCowRef JsonCowDocument::operator [] (size_t Index)
+	{
+		return Root()[Index];
+	}
+
+	JsonReclaimer::JsonReclaimer(size_t MaxQueued) :
+		MaxQueued(std::max<size_t>(MaxQueued, 1)),
+		Busy(false),
+		Stopping(false),
+		Worker(&JsonReclaimer::Run, this)
+	{
+	}
+
+	JsonReclaimer::~JsonReclaimer()
+	{
+		if (1)
+		{
+			std::lock_guard<std::mutex> Guard(Lock);
+			Stopping = true;
+		}
+		Ready.notify_one();
+		Worker.join();
+	}
+
+	void JsonReclaimer::Run()
+	{
+		std::unique_lock<std::mutex> Guard(Lock);
+		for (;;)
+		{
+			Ready.wait(Guard, [this]() { return !Queue.empty() || Stopping; });
+			if (Queue.empty()) return;
+
+			auto Json = std::move(Queue.front());
+			Queue.pop_front();
+			Busy = true;
+			Guard.unlock();
+			Progress.notify_all();
+			Json.reset();
+			Guard.lock();
+			Busy = false;
+			Progress.notify_all();
+		}
+	}
+
+	void JsonReclaimer::Reclaim(JsonDataPtr Json)
+	{
+		if (!Json || Json.use_count() > 1) return;
+		if (1)
+		{
+			std::unique_lock<std::mutex> Guard(Lock);
+			Progress.wait(Guard, [this]() { return Queue.size() < MaxQueued; });
+			Queue.push_back(std::move(Json));
+		}
+		Ready.notify_one();
+	}
+
+	void JsonReclaimer::Flush()
+	{
+		std::unique_lock<std::mutex> Guard(Lock);
+		Progress.wait(Guard, [this]() { return Queue.empty() && !Busy; });
+	}
+
+	JsonFrozenValue::JsonFrozenValue() :
+		Document(nullptr),
+		Index(0)
+	{
+	}
+
+	JsonFrozenValue::JsonFrozenValue(const JsonFrozenDocument* Document, size_t Index) :
+		Document(Document),
+		Index(Index)
+	{
+	}
+
+	JsonFrozenValue::operator bool() const
+	{
+		return Document != nullptr;
+	}
+
+	JsonDataType JsonFrozenValue::GetType() const
+	{
+		return Document ? Document->Nodes[Index].Type : JsonDataType::Unknown;
+	}
+
+	bool JsonFrozenValue::IsNull() const
+	{
+		return GetType() == JsonDataType::Null;
+	}
+
+	[[noreturn]] static void ThrowFrozenType(const char* Expected, JsonDataType Type)
+	{
+		throw WrongDataType(0, 0, std::string("Expected a JSON ") + Expected + ", got a JSON " + JsonDataTypeToString(Type));
+	}
+
+	std::string_view JsonFrozenValue::AsString() const
+	{
+		auto Type = GetType();
+		if (Type != JsonDataType::String) ThrowFrozenType("string", Type);
+		auto& Node = Document->Nodes[Index];
+		return std::string_view(Document->Text.data() + Node.Offset, Node.Size);
+	}
+
+	double JsonFrozenValue::AsNumber() const
+	{
+		auto Type = GetType();
+		if (Type != JsonDataType::Number) ThrowFrozenType("number", Type);
+		return Document->Nodes[Index].Number;
+	}
+
+	bool JsonFrozenValue::AsBoolean() const
+	{
+		auto Type = GetType();
+		if (Type != JsonDataType::Boolean) ThrowFrozenType("boolean", Type);
+		return Document->Nodes[Index].Boolean;
+	}
+
+	size_t JsonFrozenValue::size() const
+	{
+		auto Type = GetType();
+		if (Type != JsonDataType::Object && Type != JsonDataType::Array) return 0;
+		return Document->Nodes[Index].Size;
+	}
+
+	JsonFrozenValue JsonFrozenValue::operator [] (size_t Index) const
+	{
+		if (Index >= size()) return JsonFrozenValue();
+		return JsonFrozenValue(Document, Document->Nodes[this->Index].Offset + Index);
+	}
+
+	JsonFrozenValue JsonFrozenValue::operator [] (std::string_view Key) const
+	{
+		if (GetType() != JsonDataType::Object) return JsonFrozenValue();
+
+		// Members are in the order of the JsonObject they came from, which compares names like std::string_view does
+		auto& Nodes = Document->Nodes;
+		const char* Text = Document->Text.data();
+		size_t Low = Nodes[Index].Offset, High = Low + Nodes[Index].Size;
+		while (Low < High)
+		{
+			size_t Mid = Low + (High - Low) / 2;
+			auto Name = std::string_view(Text + Nodes[Mid].Key, Nodes[Mid].KeySize);
+			if (Name < Key) Low = Mid + 1;
+			else if (Key < Name) High = Mid;
+			else return JsonFrozenValue(Document, Mid);
+		}
+		return JsonFrozenValue();
+	}
+
+	std::string_view JsonFrozenValue::GetKey() const
+	{
+		if (!Document) return std::string_view();
+		auto& Node = Document->Nodes[Index];
+		return std::string_view(Document->Text.data() + Node.Key, Node.KeySize);
+	}
+
+	JsonDataPtr JsonFrozenValue::Thaw() const
+	{
+		// Makes the node of a value; that of an object or array is left empty for the loop below to fill
+		auto Make = [](const JsonFrozenValue& Value) -> JsonDataPtr
+		{
+			switch (Value.GetType())
+			{
+			case JsonDataType::Object: return MakeJsonObjectPtr();
+			case JsonDataType::Array:
+			{
+				auto Array = MakeJsonArrayPtr();
+				Array->reserve(Value.size());
+				return Array;
+			}
+			case JsonDataType::String: return MakeJsonStringPtr(Value.AsString(), 0, 0);
+			case JsonDataType::Number: return MakeJsonNumberPtr(Value.AsNumber(), 0, 0);
+			case JsonDataType::Boolean: return MakeJsonBooleanPtr(Value.AsBoolean(), 0, 0);
+			case JsonDataType::Null: return MakeJsonNullPtr();
+			default: throw WrongDataType(0, 0, "Can't thaw a missing value");
+			}
+		};
+
+		// The objects and arrays being filled, with the frozen value each is made from
+		struct Frame
+		{
+			JsonFrozenValue Value;
+			JsonData* Container;
+			size_t Index;
+		};
+		std::vector<Frame> Stack;
+
+		auto Root = Make(*this);
+		if (size()) Stack.push_back(Frame{*this, Root.get(), 0});
+		while (!Stack.empty())
+		{
+			auto& Top = Stack.back();
+			if (Top.Index == Top.Value.size())
+			{
+				Stack.pop_back();
+				continue;
+			}
+			auto Child = Top.Value[Top.Index++];
+			auto Node = Make(Child);
+			if (Top.Container->GetType() == JsonDataType::Object)
+			{
+				auto& Object = Top.Container->AsJsonObject();
+				Object.emplace_hint(Object.cend(), JsonString(Child.GetKey(), 0, 0), Node);
+			}
+			else Top.Container->AsJsonArray().push_back(Node);
+			if (Child.size()) Stack.push_back(Frame{Child, Node.get(), 0});
+		}
+		return Root;
+	}
+
+	// Fills the nodes of the children of each object or array after the node of the container itself,
+	// from a stack of the containers being filled rather than by recursion
+	JsonFrozenDocument::JsonFrozenDocument(const JsonData& Json) :
+		Nodes(1)
+	{
+		struct Frame
+		{
+			const JsonData* Container;
+			size_t Next; // Node of the next child
+			JsonObject::const_iterator Member;
+			size_t Index;
+		};
+		std::vector<Frame> Stack;
+		auto Push = [&](const JsonData& Container, size_t At)
+		{
+			bool IsObject = Container.GetType() == JsonDataType::Object;
+			Stack.push_back(Frame{&Container, Nodes[At].Offset, IsObject ? Container.AsJsonObject().cbegin() : JsonObject::const_iterator(), 0});
+		};
+
+		if (Fill(0, Json)) Push(Json, 0);
+		while (!Stack.empty())
+		{
+			auto& Top = Stack.back();
+			size_t At = Top.Next;
+			const JsonData* Child;
+			if (Top.Container->GetType() == JsonDataType::Object)
+			{
+				if (Top.Member == Top.Container->AsJsonObject().cend())
+				{
+					Stack.pop_back();
+					continue;
+				}
+				auto& Key = Top.Member->first;
+				Nodes[At].Key = Text.size();
+				Nodes[At].KeySize = static_cast<uint32_t>(Key.size());
+				Text.append(Key);
+				Child = Top.Member++->second.get();
+			}
+			else
+			{
+				if (Top.Index == Top.Container->AsJsonArray().size())
+				{
+					Stack.pop_back();
+					continue;
+				}
+				Child = Top.Container->AsJsonArray().cbegin()[Top.Index++].get();
+			}
+			Top.Next++;
+			if (Fill(At, *Child)) Push(*Child, At);
+		}
+		Nodes.shrink_to_fit();
+		Text.shrink_to_fit();
+	}
+
+	// Fills in the node at At, which was value-initialized and has its member name already. For an object or array it
+	// appends value-initialized nodes for the children and returns true, leaving those to the caller (a typed array fills them).
+	bool JsonFrozenDocument::Fill(size_t At, const JsonData& Json)
+	{
+		Nodes[At].Type = Json.GetType();
+		switch (Json.GetType())
+		{
+		case JsonDataType::Object:
+		{
+			auto& Object = Json.AsJsonObject();
+			size_t First = Nodes.size();
+			Nodes.resize(First + Object.size());
+			Nodes[At].Offset = First;
+			Nodes[At].Size = Object.size();
+			return true;
+		}
+		case JsonDataType::Array:
+		{
+			auto& Array = Json.AsJsonArray();
+			auto Typed = Array.ShareTypedElements();
+			size_t Size = Typed ? Typed->size() : Array.size();
+			size_t First = Nodes.size();
+			Nodes.resize(First + Size);
+			Nodes[At].Offset = First;
+			Nodes[At].Size = Size;
+			if (!Typed) return true;
+			bool Booleans = Typed->GetElementType() == JsonTypedElements::ElementType::Boolean;
+			for (size_t i = 0; i < Size; i++)
+			{
+				auto& Node = Nodes[First + i];
+				Node.Type = Booleans ? JsonDataType::Boolean : JsonDataType::Number;
+				if (Booleans) Node.Boolean = Typed->GetBoolean(i);
+				else Node.Number = Typed->GetNumber(i);
+			}
+			return false;
+		}
+		case JsonDataType::String:
+		{
+			auto& String = Json.AsJsonString();
+			Nodes[At].Offset = Text.size();
+			Nodes[At].Size = String.size();
+			Text.append(String);
+			return false;
+		}
+		case JsonDataType::Number:
+			Nodes[At].Number = Json.AsJsonNumber().Value;
+			return false;
+		case JsonDataType::Boolean:
+			Nodes[At].Boolean = Json.AsJsonBoolean().Value;
+			return false;
+		default:
+			return false;
+		}
+	}
+
+	JsonFrozenValue JsonFrozenDocument::Root() const
+	{
+		return JsonFrozenValue(this, 0);
+	}
+
+	JsonFrozenValue JsonFrozenDocument::operator [] (size_t Index) const
+	{
+		return Root()[Index];
+	}
+
+	JsonFrozenValue JsonFrozenDocument::operator [] (std::string_view Key) const
+	{
+		return Root()[Key];
+	}
+
+	std::shared_ptr<const JsonFrozenDocument> Freeze(const JsonData& Json)
+	{
+		return std::make_shared<const JsonFrozenDocument>(Json);
+	}
+
+	JsonSchemaError::JsonSchemaError(const std::string& what) noexcept :
+		std::runtime_error(what)
+	{
+	}
+
+	// Bits of JsonSchemaNode::Types
+	enum JsonSchemaTypeBits : uint32_t
+	{
+		SchemaNull = 1,
+		SchemaBoolean = 2,
+		SchemaObject = 4,
+		SchemaArray = 8,
+		SchemaNumber = 16,
+		SchemaInteger = 32, // Numbers without a fraction, included in SchemaNumber
+		SchemaString = 64,
+		SchemaAnyType = 127,
+	};
+
+	// Child schema indices: a node in JsonSchemaProgram::Nodes, or one of these
+	constexpr int SchemaAny = -1;
+	constexpr int SchemaRejected = -2; // additionalProperties: false
+
+	// An enum or const entry; only scalars are supported
+	struct JsonSchemaScalar
+	{
+		uint32_t Type;
+		double Number;
+		std::string String;
+
+		bool Matches(uint32_t ValueType, double ValueNumber, std::string_view ValueString) const
+		{
+			if (!(Type & ValueType)) return false;
+			switch (Type)
+			{
+			case SchemaBoolean:
+			case SchemaNumber: return Number == ValueNumber;
+			case SchemaString: return String == ValueString;
+			}
+			return true;
+		}
+	};
+
+	struct JsonSchemaNode
+	{
+		bool Never = false;
+		uint32_t Types = SchemaAnyType;
+
+		std::vector<std::pair<std::string, int>> Properties; // Sorted by name
+		std::vector<std::string> Required; // Sorted, unique
+		int AdditionalProperties = SchemaAny;
+		int Items = SchemaAny;
+
+		bool HasEnum = false;
+		JsonSchemaKeyword EnumKeyword = JsonSchemaKeyword::Enum;
+		std::vector<JsonSchemaScalar> Enum;
+
+		double Minimum = -HUGE_VAL;
+		double Maximum = HUGE_VAL;
+		double ExclusiveMinimum = -HUGE_VAL;
+		double ExclusiveMaximum = HUGE_VAL;
+		size_t MinLength = 0;
+		size_t MaxLength = SIZE_MAX;
+		size_t MinItems = 0;
+		size_t MaxItems = SIZE_MAX;
+		size_t MinProperties = 0;
+		size_t MaxProperties = SIZE_MAX;
+
+		bool HasPattern = false;
+		std::regex Pattern;
+	};
+
+	struct JsonSchemaProgram
+	{
+		std::vector<JsonSchemaNode> Nodes; // The root is node 0
+	};
+
+	// Turns schema objects into JsonSchemaProgram nodes
+	class JsonSchemaCompiler
+	{
+	protected:
+		JsonSchemaProgram& Program;
+
+		[[noreturn]] static void Error(std::string_view Keyword, const std::string& What)
+		{
+			throw JsonSchemaError("JSON Schema keyword '" + std::string(Keyword) + "' " + What);
+		}
+
+		static double GetNumber(std::string_view Keyword, const JsonData& Value)
+		{
+			auto Number = Value.TryAsJsonNumber();
+			if (!Number) Error(Keyword, "must be a number");
+			return Number->Value;
+		}
+
+		static size_t GetCount(std::string_view Keyword, const JsonData& Value)
+		{
+			double Number = GetNumber(Keyword, Value);
+			if (!(Number >= 0) || Number != std::floor(Number)) Error(Keyword, "must be a non-negative integer");
+			if (Number >= 18446744073709551616.0) return SIZE_MAX;
+			return static_cast<size_t>(Number);
+		}
+
+		static uint32_t GetType(const JsonData& Value)
+		{
+			auto Name = Value.TryAsJsonString();
+			if (!Name) Error("type", "must be a string or an array of strings");
+			if (*Name == "null") return SchemaNull;
+			if (*Name == "boolean") return SchemaBoolean;
+			if (*Name == "object") return SchemaObject;
+			if (*Name == "array") return SchemaArray;
+			if (*Name == "number") return SchemaNumber | SchemaInteger;
+			if (*Name == "integer") return SchemaInteger;
+			if (*Name == "string") return SchemaString;
+			Error("type", "has unknown type '" + std::string(*Name) + "'");
+		}
+
+		static JsonSchemaScalar GetScalar(std::string_view Keyword, const JsonData& Value)
+		{
+			JsonSchemaScalar Scalar{0, 0, ""};
+			switch (Value.GetType())
+			{
+			case JsonDataType::Null: Scalar.Type = SchemaNull; break;
+			case JsonDataType::Boolean: Scalar.Type = SchemaBoolean; Scalar.Number = Value.AsJsonBoolean().Value ? 1 : 0; break;
+			case JsonDataType::Number: Scalar.Type = SchemaNumber; Scalar.Number = Value.AsJsonNumber().Value; break;
+			case JsonDataType::String: Scalar.Type = SchemaString; Scalar.String = Value.AsJsonString(); break;
+			default: Error(Keyword, "is only supported for strings, numbers, booleans and null");
+			}
+			return Scalar;
+		}
+
+	public:
+		JsonSchemaCompiler(JsonSchemaProgram& Program) :
+			Program(Program)
+		{
+		}
+
+		// Returns the node index, or SchemaAny for a schema that accepts everything
+		int Compile(const JsonData& Schema)
+		{
+			if (auto Boolean = Schema.TryAsJsonBoolean())
+			{
+				if (Boolean->Value) return SchemaAny;
+				int Index = static_cast<int>(Program.Nodes.size());
+				Program.Nodes.emplace_back().Never = true;
+				return Index;
+			}
+			auto Object = Schema.TryAsJsonObject();
+			if (!Object) throw JsonSchemaError("A JSON Schema must be an object or a boolean");
+
+			int Index = static_cast<int>(Program.Nodes.size());
+			Program.Nodes.emplace_back();
+			JsonSchemaNode Node;
+
+			for (auto& [Name, ValuePtr] : *Object)
+			{
+				std::string_view Keyword = Name;
+				auto& Value = *ValuePtr;
+				if (Keyword == "type")
+				{
+					if (auto Types = Value.TryAsJsonArray())
+					{
+						Node.Types = 0;
+						for (auto& Type : *Types) Node.Types |= GetType(*Type);
+					}
+					else Node.Types = GetType(Value);
+				}
+				else if (Keyword == "enum" || Keyword == "const")
+				{
+					Node.HasEnum = true;
+					Node.Enum.clear();
+					if (Keyword == "const")
+					{
+						Node.EnumKeyword = JsonSchemaKeyword::Const;
+						Node.Enum.push_back(GetScalar(Keyword, Value));
+					}
+					else
+					{
+						auto Values = Value.TryAsJsonArray();
+						if (!Values) Error(Keyword, "must be an array");
+						for (auto& Entry : *Values) Node.Enum.push_back(GetScalar(Keyword, *Entry));
+					}
+				}
+				else if (Keyword == "properties")
+				{
+					auto Properties = Value.TryAsJsonObject();
+					if (!Properties) Error(Keyword, "must be an object");
+					for (auto& [Property, Sub] : *Properties)
+						Node.Properties.emplace_back(std::string(Property), Compile(*Sub));
+				}
+				else if (Keyword == "required")
+				{
+					auto Names = Value.TryAsJsonArray();
+					if (!Names) Error(Keyword, "must be an array of strings");
+					for (auto& Name : *Names)
+					{
+						auto String = Name->TryAsJsonString();
+						if (!String) Error(Keyword, "must be an array of strings");
+						Node.Required.emplace_back(*String);
+					}
+					std::sort(Node.Required.begin(), Node.Required.end());
+					Node.Required.erase(std::unique(Node.Required.begin(), Node.Required.end()), Node.Required.end());
+				}
+				else if (Keyword == "additionalProperties")
+				{
+					auto Boolean = Value.TryAsJsonBoolean();
+					Node.AdditionalProperties = Boolean && !Boolean->Value ? SchemaRejected : Compile(Value);
+				}
+				else if (Keyword == "items") Node.Items = Compile(Value);
+				else if (Keyword == "minimum") Node.Minimum = GetNumber(Keyword, Value);
+				else if (Keyword == "maximum") Node.Maximum = GetNumber(Keyword, Value);
+				else if (Keyword == "exclusiveMinimum") Node.ExclusiveMinimum = GetNumber(Keyword, Value);
+				else if (Keyword == "exclusiveMaximum") Node.ExclusiveMaximum = GetNumber(Keyword, Value);
+				else if (Keyword == "minLength") Node.MinLength = GetCount(Keyword, Value);
+				else if (Keyword == "maxLength") Node.MaxLength = GetCount(Keyword, Value);
+				else if (Keyword == "minItems") Node.MinItems = GetCount(Keyword, Value);
+				else if (Keyword == "maxItems") Node.MaxItems = GetCount(Keyword, Value);
+				else if (Keyword == "minProperties") Node.MinProperties = GetCount(Keyword, Value);
+				else if (Keyword == "maxProperties") Node.MaxProperties = GetCount(Keyword, Value);
+				else if (Keyword == "pattern")
+				{
+					auto Pattern = Value.TryAsJsonString();
+					if (!Pattern) Error(Keyword, "must be a string");
+					try
+					{
+						Node.Pattern = std::regex(Pattern->begin(), Pattern->end(), std::regex::ECMAScript);
+					}
+					catch (const std::regex_error&)
+					{
+						Error(Keyword, "is not a valid regular expression");
+					}
+					Node.HasPattern = true;
+				}
+				else if (Keyword == "$ref" || Keyword == "$dynamicRef" || Keyword == "$recursiveRef" ||
+					Keyword == "allOf" || Keyword == "anyOf" || Keyword == "oneOf" || Keyword == "not" ||
+					Keyword == "if" || Keyword == "then" || Keyword == "else" ||
+					Keyword == "prefixItems" || Keyword == "additionalItems" || Keyword == "contains" ||
+					Keyword == "minContains" || Keyword == "maxContains" || Keyword == "uniqueItems" ||
+					Keyword == "patternProperties" || Keyword == "propertyNames" ||
+					Keyword == "dependentSchemas" || Keyword == "dependentRequired" || Keyword == "dependencies" ||
+					Keyword == "unevaluatedItems" || Keyword == "unevaluatedProperties" || Keyword == "multipleOf")
+				{
+					Error(Keyword, "is not supported");
+				}
+			}
+
+			std::sort(Node.Properties.begin(), Node.Properties.end());
+			Program.Nodes[Index] = std::move(Node);
+			return Index;
+		}
+	};
+
+	JsonSchema::JsonSchema(const JsonData& Schema)
+	{
+		auto Compiled = std::make_shared<JsonSchemaProgram>();
+		JsonSchemaCompiler Compiler(*Compiled);
+		if (Compiler.Compile(Schema) == SchemaAny)
+		{
+			// Keep node 0 as the root
+			Compiled->Nodes.emplace_back();
+		}
+		Program = std::move(Compiled);
+	}
+
+	// Runs a JsonSchemaProgram over the events of JsonParser::Scan(), or of a walk over a parsed document
+	class JsonSchemaValidator
+	{
+	protected:
+		struct Frame
+		{
+			int Schema;
+			bool IsObject;
+			size_t Count; // Members or elements seen
+			size_t SeenBase; // The flags for Required start here in Seen
+			int Pending; // Schema of the next member value
+		};
+
+		const JsonSchemaProgram& Program;
+		std::vector<Frame> Stack;
+		std::vector<bool> Seen;
+		bool Started;
+		JsonSchemaKeyword Failure;
+
+		bool Fail(JsonSchemaKeyword Keyword)
+		{
+			Failure = Keyword;
+			return false;
+		}
+
+		// Finds the schema of the value that starts now
+		bool Next(int& Schema)
+		{
+			if (Stack.empty())
+			{
+				Schema = Started ? SchemaAny : 0;
+				Started = true;
+				return true;
+			}
+			auto& Top = Stack.back();
+			if (Top.IsObject)
+			{
+				Schema = Top.Pending;
+				return true;
+			}
+			Top.Count++;
+			if (Top.Schema < 0)
+			{
+				Schema = SchemaAny;
+				return true;
+			}
+			auto& Node = Program.Nodes[Top.Schema];
+			if (Top.Count > Node.MaxItems) return Fail(JsonSchemaKeyword::MaxItems);
+			Schema = Node.Items;
+			return true;
+		}
+
+		// The checks every kind of value has
+		bool CheckValue(const JsonSchemaNode& Node, uint32_t Type, double Number = 0, std::string_view String = {})
+		{
+			if (Node.Never) return Fail(JsonSchemaKeyword::False);
+			if (!(Node.Types & Type)) return Fail(JsonSchemaKeyword::Type);
+			if (Node.HasEnum)
+			{
+				bool Found = false;
+				for (auto& Entry : Node.Enum)
+				{
+					if (Entry.Matches(Type, Number, String))
+					{
+						Found = true;
+						break;
+					}
+				}
+				if (!Found) return Fail(Node.EnumKeyword);
+			}
+			return true;
+		}
+
+		bool Start(bool IsObject)
+		{
+			int Schema;
+			if (!Next(Schema)) return false;
+			size_t SeenBase = Seen.size();
+			if (Schema >= 0)
+			{
+				auto& Node = Program.Nodes[Schema];
+				if (!CheckValue(Node, IsObject ? SchemaObject : SchemaArray)) return false;
+				if (IsObject) Seen.resize(SeenBase + Node.Required.size(), false);
+			}
+			Stack.push_back(Frame{Schema, IsObject, 0, SeenBase, SchemaAny});
+			return true;
+		}
+
+	public:
+		static constexpr bool WantsValues = true;
+
+		JsonSchemaValidator(const JsonSchemaProgram& Program) :
+			Program(Program),
+			Started(false),
+			Failure(JsonSchemaKeyword::None)
+		{
+		}
+
+		bool StartObject()
+		{
+			return Start(true);
+		}
+
+		bool StartArray()
+		{
+			return Start(false);
+		}
+
+		bool EndObject()
+		{
+			auto Top = Stack.back();
+			Stack.pop_back();
+			if (Top.Schema < 0) return true;
+			auto& Node = Program.Nodes[Top.Schema];
+			for (size_t i = 0; i < Node.Required.size(); i++)
+			{
+				if (!Seen[Top.SeenBase + i]) return Fail(JsonSchemaKeyword::Required);
+			}
+			Seen.resize(Top.SeenBase);
+			if (Top.Count < Node.MinProperties) return Fail(JsonSchemaKeyword::MinProperties);
+			return true;
+		}
+
+		bool EndArray()
+		{
+			auto Top = Stack.back();
+			Stack.pop_back();
+			if (Top.Schema < 0) return true;
+			if (Top.Count < Program.Nodes[Top.Schema].MinItems) return Fail(JsonSchemaKeyword::MinItems);
+			return true;
+		}
+
+		bool Key(std::string_view Name)
+		{
+			auto& Top = Stack.back();
+			Top.Count++;
+			if (Top.Schema < 0)
+			{
+				Top.Pending = SchemaAny;
+				return true;
+			}
+			auto& Node = Program.Nodes[Top.Schema];
+			if (Top.Count > Node.MaxProperties) return Fail(JsonSchemaKeyword::MaxProperties);
+
+			auto Required = std::lower_bound(Node.Required.begin(), Node.Required.end(), Name);
+			if (Required != Node.Required.end() && *Required == Name) Seen[Top.SeenBase + (Required - Node.Required.begin())] = true;
+
+			auto Property = std::lower_bound(Node.Properties.begin(), Node.Properties.end(), Name,
+				[](const std::pair<std::string, int>& Entry, std::string_view Name) { return Entry.first < Name; });
+			if (Property != Node.Properties.end() && Property->first == Name) Top.Pending = Property->second;
+			else if (Node.AdditionalProperties == SchemaRejected) return Fail(JsonSchemaKeyword::AdditionalProperties);
+			else Top.Pending = Node.AdditionalProperties;
+			return true;
+		}
+
+		bool String(std::string_view Value)
+		{
+			int Schema;
+			if (!Next(Schema)) return false;
+			if (Schema < 0) return true;
+			auto& Node = Program.Nodes[Schema];
+			if (!CheckValue(Node, SchemaString, 0, Value)) return false;
+			if (Node.MinLength || Node.MaxLength != SIZE_MAX)
+			{
+				// Lengths are in code points
+				size_t Length = 0;
+				for (char ch : Value) Length += (static_cast<uint8_t>(ch) & 0xC0) != 0x80;
+				if (Length < Node.MinLength) return Fail(JsonSchemaKeyword::MinLength);
+				if (Length > Node.MaxLength) return Fail(JsonSchemaKeyword::MaxLength);
+			}
+			if (Node.HasPattern && !std::regex_search(Value.begin(), Value.end(), Node.Pattern)) return Fail(JsonSchemaKeyword::Pattern);
+			return true;
+		}
+
+		bool Number(double Value)
+		{
+			int Schema;
+			if (!Next(Schema)) return false;
+			if (Schema < 0) return true;
+			auto& Node = Program.Nodes[Schema];
+			uint32_t Type = Value == std::floor(Value) ? SchemaNumber | SchemaInteger : SchemaNumber;
+			if (!CheckValue(Node, Type, Value)) return false;
+			if (Value < Node.Minimum) return Fail(JsonSchemaKeyword::Minimum);
+			if (Value > Node.Maximum) return Fail(JsonSchemaKeyword::Maximum);
+			if (Value <= Node.ExclusiveMinimum) return Fail(JsonSchemaKeyword::ExclusiveMinimum);
+			if (Value >= Node.ExclusiveMaximum) return Fail(JsonSchemaKeyword::ExclusiveMaximum);
+			return true;
+		}
+
+		bool Boolean(bool Value)
+		{
+			int Schema;
+			if (!Next(Schema)) return false;
+			return Schema < 0 || CheckValue(Program.Nodes[Schema], SchemaBoolean, Value ? 1 : 0);
+		}
+
+		bool Null()
+		{
+			int Schema;
+			if (!Next(Schema)) return false;
+			return Schema < 0 || CheckValue(Program.Nodes[Schema], SchemaNull);
+		}
+
+		int GetFailure() const
+		{
+			return static_cast<int>(Failure);
+		}
+
+		// Feeds a parsed document in, from a stack of the objects and arrays entered rather than by recursion;
+		// returns the node that failed, or nullptr
+		const JsonData* Walk(const JsonData& Json)
+		{
+			struct Frame
+			{
+				const JsonData* Container;
+				JsonObject::const_iterator Member;
+				size_t Index;
+			};
+			std::vector<Frame> Stack;
+
+			// Feeds a value in, entering an object or array; false when it failed
+			auto Open = [&](const JsonData& Value)
+			{
+				switch (Value.GetType())
+				{
+				case JsonDataType::Object:
+					if (!StartObject()) return false;
+					Stack.push_back(Frame{&Value, Value.AsJsonObject().cbegin(), 0});
+					return true;
+				case JsonDataType::Array:
+					if (!StartArray()) return false;
+					if (auto Typed = Value.AsJsonArray().ShareTypedElements())
+					{
+						// Elements of a typed array have no node, so the array stands in for them
+						bool Booleans = Typed->GetElementType() == JsonTypedElements::ElementType::Boolean;
+						for (size_t i = 0; i < Typed->size(); i++)
+						{
+							if (!(Booleans ? Boolean(Typed->GetBoolean(i)) : Number(Typed->GetNumber(i)))) return false;
+						}
+						return EndArray();
+					}
+					Stack.push_back(Frame{&Value, {}, 0});
+					return true;
+				case JsonDataType::String: return String(Value.AsJsonString());
+				case JsonDataType::Number: return Number(Value.AsJsonNumber().Value);
+				case JsonDataType::Boolean: return Boolean(Value.AsJsonBoolean().Value);
+				case JsonDataType::Null: return Null();
+				default: return true;
+				}
+			};
+
+			if (!Open(Json)) return &Json;
+			while (!Stack.empty())
+			{
+				auto& Top = Stack.back();
+				const JsonData* Child;
+				if (Top.Container->GetType() == JsonDataType::Object)
+				{
+					if (Top.Member == Top.Container->AsJsonObject().cend())
+					{
+						const JsonData* Container = Top.Container;
+						Stack.pop_back();
+						if (!EndObject()) return Container;
+						continue;
+					}
+					if (!Key(Top.Member->first)) return Top.Container;
+					Child = Top.Member++->second.get();
+				}
+				else
+				{
+					if (Top.Index == Top.Container->AsJsonArray().size())
+					{
+						const JsonData* Container = Top.Container;
+						Stack.pop_back();
+						if (!EndArray()) return Container;
+						continue;
+					}
+					Child = Top.Container->AsJsonArray().cbegin()[Top.Index++].get();
+				}
+				if (!Open(*Child)) return Child;
+			}
+			return nullptr;
+		}
+	};
+
+	JsonParseResult JsonSchema::Validate(std::string_view s, const JsonValidateOptions& Options) const
+	{
+		JsonParser jp(s);
+		jp.AllowComments = Options.AllowComments;
+		if (Options.MaxSize && s.size() > Options.MaxSize)
+		{
+			jp.Fail(JsonErrorCode::TooLarge, Options.MaxSize);
+			return jp.GetErrorResult();
+		}
+
+		JsonParseResult Result;
+		if (!jp.SkipSpacesAndComments()) return jp.GetErrorResult();
+		if (jp.End()) return Result;
+		JsonSchemaValidator Validator(*Program);
+		if (!jp.Scan(Validator, Options.MaxDepth) || !jp.SkipSpacesAndComments()) return jp.GetErrorResult();
+		if (!jp.End())
+		{
+			jp.Fail(JsonErrorCode::ExtraData, jp.Offset());
+			return jp.GetErrorResult();
+		}
+		return Result;
+	}
+
+	JsonParseResult JsonSchema::Validate(const JsonData& Json) const
+	{
+		JsonSchemaValidator Validator(*Program);
+		JsonParseResult Result;
+		if (auto Failed = Validator.Walk(Json))
+		{
+			Result.Error = JsonErrorCode::SchemaViolation;
+			Result.LineNo = Failed->GetLineNo();
+			Result.Column = Failed->GetColumn();
+			Result.Character = Validator.GetFailure();
+		}
+		return Result;
+	}
+
+	JsonParseResult JsonSchema::Parse(const std::string& s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc) const
+	{
+		JsonValidateOptions ValidateOptions;
+		ValidateOptions.AllowComments = Options.AllowComments;
+		ValidateOptions.MaxDepth = JsonMaxValidateDepth;
+		auto Result = Validate(s, ValidateOptions);
+		if (!Result) return Result;
+		return JsonData::TryParseJson(s, Options, Alloc);
 	}
 }
 
@@ -7,6 +7,21 @@
 #include <stdexcept>
 #include <cstdint>
 #include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <atomic>
+#include <initializer_list>
+#include <string_view>
+#include <span>
+#include <cstddef>
+#include <bit>
+#include <limits>
+#ifdef JSON_USE_PMR
+#include <memory_resource>
+#endif
 
 namespace JsonLibrary
 {
@@ -42,6 +57,27 @@ namespace JsonLibrary
 		UnicodeDecodeError(size_t FromLineNo, size_t FromColumn, const std::string& what) noexcept;
 	};
 
+	// A schema that JsonSchema cannot compile
+	class JsonSchemaError : public std::runtime_error
+	{
+	public:
+		JsonSchemaError(const std::string& what) noexcept;
+	};
+
+	// WriteJsonToFile() could not create, write or replace the file
+	class JsonWriteError : public std::runtime_error
+	{
+	public:
+		JsonWriteError(const std::string& what) noexcept;
+	};
+
+	// A value that has no canonical form: a number that is NaN or infinite, or a string with a lone surrogate
+	class JsonEncodeError : public std::runtime_error
+	{
+	public:
+		JsonEncodeError(const std::string& what) noexcept;
+	};
+
 	class WrongDataType : public std::invalid_argument
 	{
 	protected:
@@ -68,14 +104,73 @@ namespace JsonLibrary
 	extern const std::unordered_map<JsonDataType, const char*> JsonDataTypeToStringMap;
 	std::string JsonDataTypeToString(JsonDataType jd);
 
+	// Statistics are only collected when the library is compiled with JSON_STATISTICS defined.
+	// Otherwise every hook compiles to nothing and the functions below do nothing.
+#ifdef JSON_STATISTICS
+	constexpr bool JsonStatisticsEnabled = true;
+#else
+	constexpr bool JsonStatisticsEnabled = false;
+#endif
+
+	struct JsonStatistics
+	{
+		size_t Parses = 0;
+		size_t BytesParsed = 0;
+		size_t Nodes[7] = {}; // Indexed by JsonDataType
+		size_t MaxDepth = 0;
+		size_t StringBytes = 0; // Unescaped bytes of string values and object keys
+		size_t Allocations = 0; // Nodes, object members, out-of-line string buffers and array growth
+		double ParseSeconds = 0;
+
+		size_t Serializations = 0;
+		size_t BytesSerialized = 0;
+		double SerializeSeconds = 0;
+
+		void Reset();
+		JsonStatistics& operator += (const JsonStatistics& s);
+	};
+
+	using JsonStatisticsCallback = std::function<void(const JsonStatistics& ParseStats)>;
+
+	// Accumulates the statistics of every successful parse and every top-level ToString() on the current thread into `Stats` while alive.
+	class JsonStatisticsScope
+	{
+	protected:
+		JsonStatistics* Previous;
+
+	public:
+		JsonStatisticsScope(JsonStatistics& Stats);
+		JsonStatisticsScope(const JsonStatisticsScope& c) = delete;
+		~JsonStatisticsScope();
+	};
+
+	// Calls `Callback` with the statistics of a single parse when it takes at least `LatencySeconds` or reads at least `Bytes` bytes.
+	// A zero threshold is ignored, an empty callback removes the hook.
+	void SetJsonParseThreshold(double LatencySeconds, size_t Bytes, JsonStatisticsCallback Callback);
+
+	// With JSON_USE_PMR defined, strings, containers and the nodes created by the parser allocate through std::pmr,
+	// so a parse can be served from a per-request or per-worker std::pmr::memory_resource.
+	// Without it the same names resolve to the plain std::string, std::map and std::vector.
+#ifdef JSON_USE_PMR
+	template<typename T> using JsonAllocator = std::pmr::polymorphic_allocator<T>;
+#else
+	template<typename T> using JsonAllocator = std::allocator<T>;
+#endif
+	using JsonAllocatorType = JsonAllocator<std::byte>;
+
 	class JsonData;
 	class JsonObject;
 	class JsonArray;
+	class JsonSourceObject;
+	class JsonSourceArray;
 	class JsonString;
 	class JsonNumber;
 	class JsonBoolean;
 	class JsonNull;
 	class JsonParser;
+#ifdef JSON_USE_PMR
+	class JsonInSituResource;
+#endif
 
 	template<typename T> using JsonPtr = std::shared_ptr<T>;
 	using JsonDataPtr = JsonPtr<JsonData>;
@@ -85,18 +180,156 @@ namespace JsonLibrary
 	using JsonNumberPtr = JsonPtr<JsonNumber>;
 	using JsonBooleanPtr = JsonPtr<JsonBoolean>;
 	using JsonNullPtr = JsonPtr<JsonNull>;
+	using JsonConstDataPtr = JsonPtr<const JsonData>;
+
+	struct JsonParseOptions
+	{
+		// Keep a shared copy of the input so that objects and arrays remember the bytes they were parsed from.
+		// ToStringSpliced() copies those bytes for every container that was not modified since.
+		bool RetainSource = false;
+
+		// Give the nodes the line and column they were parsed from.
+		// Without it they get 0, 0; errors still report where they happened.
+		// Nodes store them in 32 bits, so lines and columns past UINT32_MAX read as UINT32_MAX (errors report them in full).
+		bool TrackPositions = true;
+
+		// Accept // and /* */ comments
+		bool AllowComments = true;
+
+		// Deeper nesting fails with JsonErrorCode::TooDeep
+		size_t MaxDepth = 1024;
+
+		// Numbers also keep their literal (JsonNumber::GetLiteral()), and serialize as that literal until Value is changed.
+		// Literals longer than JsonLazyNumber::MaxLiteral are not kept. Values are still converted while parsing; this
+		// is for keeping the digits as written, and a kept literal makes its node twice the size of a plain one.
+		bool LazyNumbers = false;
+
+		// Objects and arrays inside LazyDepth others are only checked while parsing; their members are parsed from a shared
+		// copy of the input when first accessed, and ToStringSpliced() copies the input of those never accessed.
+		// The check is that of ValidateJson() plus number ranges, so a lazy parse fails exactly where a full one would,
+		// except that nesting below the first deferred container is limited to JsonMaxValidateDepth.
+		size_t LazyDepth = SIZE_MAX;
+
+		// Arrays whose elements are all numbers, or all booleans, keep them as one buffer instead of a node each, integers
+		// exactly as int64_t (see JsonArray::ShareTypedElements()). The nodes are made, without positions, when an element
+		// is first accessed as one or the array is modified, and then replace the buffer. size(), serializing, Hash(), ==,
+		// Copy(), DiffJson(), frozen documents and schemas read the buffer. Ignored with LazyNumbers, whose nodes keep their
+		// literals.
+		bool TypedArrays = false;
+
+		// The file parse functions read ahead on a background thread while parsing, in blocks of ReadAheadBlockSize bytes,
+		// keeping at most ReadAheadBlocks of them in memory. With RetainSource the whole file is read first instead.
+		size_t ReadAheadBlockSize = 1 << 20;
+		size_t ReadAheadBlocks = 4;
+	};
+
+	// The validator keeps its nesting on a fixed bit stack, which caps MaxDepth
+	constexpr size_t JsonMaxValidateDepth = 65536;
+
+	struct JsonValidateOptions
+	{
+		bool AllowComments = true;
+		size_t MaxDepth = 1024; // At most JsonMaxValidateDepth
+		size_t MaxSize = 0; // In bytes, 0 for no limit
+	};
+
+	enum class JsonErrorCode
+	{
+		None,
+		UnexpectedEnd,
+		UnexpectedCharacter,
+		InvalidUtf8,
+		TruncatedUtf8,
+		InvalidControlCharacter,
+		InvalidEscape,
+		ExpectedDigit,
+		NumberOutOfRange,
+		InvalidLiteral,
+		KeyMustBeString,
+		ExpectedColon,
+		UnterminatedComment,
+		ExtraData,
+		CouldNotReadFile,
+		TooDeep,
+		TooLarge,
+		SchemaViolation, // Character holds the JsonSchemaKeyword that failed
+	};
+
+	// The keyword a document failed in JsonSchema::Validate()
+	enum class JsonSchemaKeyword
+	{
+		None,
+		False, // The schema is false
+		Type,
+		Enum,
+		Const,
+		Minimum,
+		Maximum,
+		ExclusiveMinimum,
+		ExclusiveMaximum,
+		MinLength,
+		MaxLength,
+		Pattern,
+		MinItems,
+		MaxItems,
+		MinProperties,
+		MaxProperties,
+		Required,
+		AdditionalProperties,
+	};
+
+	// Outcome of the non-throwing parse functions.
+	// Nothing is thrown or formatted on failure; GetMessage() puts the message together when asked.
+	class JsonParseResult
+	{
+	public:
+		JsonDataPtr Value; // nullptr on failure, and for an input without a value
+		JsonErrorCode Error;
+		size_t Offset; // Byte offset of the error
+		size_t LineNo;
+		size_t Column;
+		int Character; // The unexpected character, or the byte that does not decode
+
+		JsonParseResult();
+
+		explicit operator bool() const;
+		std::string GetMessage() const;
+
+		// Throws what the throwing parse functions throw for this error
+		[[noreturn]] void Throw() const;
+	};
+
+	// The input bytes an object or array was parsed from
+	class JsonSourceSpan
+	{
+	protected:
+		std::shared_ptr<const char> Data;
+		size_t Size;
+
+	public:
+		JsonSourceSpan();
+		JsonSourceSpan(const std::shared_ptr<const std::string>& Source, size_t Begin, size_t End);
+		JsonSourceSpan(const JsonSourceSpan& Within, size_t Begin, size_t End); // Offsets into Within
+
+		std::string_view View() const;
+		explicit operator bool() const;
+		void reset();
+	};
 
 	class JsonData
 	{
 	protected:
 		JsonDataType Type;
-		size_t LineNo;
-		size_t Column;
+		uint32_t LineNo; // Position in the parsed text, 0 when unknown, and UINT32_MAX from there on
+		uint32_t Column;
+		bool Extended; // A JsonSourceObject or JsonSourceArray; set by their constructors only
 
 		JsonData(JsonDataType Type, size_t FromLineNo = 0, size_t FromColumn = 0);
 
-		static void AddIndent(std::stringstream& ss, int indent, const std::string& indent_type);
 		static JsonDataPtr ParseJson(JsonParser& jp);
+		static JsonParseResult TryParseJson(JsonParser& jp);
+
+		friend class JsonReusableParser;
 
 	public:
 		JsonData() = delete;
@@ -104,9 +337,28 @@ namespace JsonLibrary
 
 		JsonDataType GetType() const;
 		virtual std::string ToString(int indent = 0, int cur_indent = 0, const std::string& indent_type = " ") const = 0;
+		// Copies this node only; the children of an object or array are shared with the copy.
 		virtual JsonDataPtr Copy() const = 0;
 
-		static JsonDataPtr ParseJson(const std::string& s);
+		// Structural hash: equal values (operator ==) have equal hashes regardless of where they came from.
+		// It is computed from the whole subtree on every call.
+		virtual size_t Hash() const = 0;
+
+		// Drops what this node caches about its contents: the source span of a JsonSourceObject or JsonSourceArray.
+		// The members of JsonObject and JsonArray that insert, erase or assign, and operator [], call it themselves.
+		// Writes through an iterator, a reference from front(), back() or data(), or a retained pointer to a descendant
+		// must be followed by Invalidate() on the container and each of its ancestors.
+		virtual void Invalidate();
+
+		static JsonDataPtr ParseJson(const std::string& s, const JsonAllocatorType& Alloc = {});
+		static JsonDataPtr ParseJson(const std::string& s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc = {});
+		static JsonParseResult TryParseJson(const std::string& s, const JsonParseOptions& Options = {}, const JsonAllocatorType& Alloc = {});
+		// Shares s, which must not be null, with deferred containers and RetainSource spans instead of copying it
+		static JsonParseResult TryParseJson(std::shared_ptr<const std::string> s, const JsonParseOptions& Options = {}, const JsonAllocatorType& Alloc = {});
+		static JsonParseResult TryParseJsonFile(const std::string& FilePath, const JsonParseOptions& Options = {}, const JsonAllocatorType& Alloc = {});
+#ifdef JSON_USE_PMR
+		static JsonParseResult TryParseJsonInSitu(JsonInSituResource& Resource, const JsonParseOptions& Options = {});
+#endif
 
 		size_t GetLineNo() const;
 		size_t GetColumn() const;
@@ -123,6 +375,23 @@ namespace JsonLibrary
 		const JsonNumber& AsJsonNumber() const;
 		const JsonBoolean& AsJsonBoolean() const;
 
+		// nullptr instead of WrongDataType
+		JsonObject* TryAsJsonObject();
+		JsonArray* TryAsJsonArray();
+		JsonString* TryAsJsonString();
+		JsonNumber* TryAsJsonNumber();
+		JsonBoolean* TryAsJsonBoolean();
+
+		const JsonObject* TryAsJsonObject() const;
+		const JsonArray* TryAsJsonArray() const;
+		const JsonString* TryAsJsonString() const;
+		const JsonNumber* TryAsJsonNumber() const;
+		const JsonBoolean* TryAsJsonBoolean() const;
+
+		// nullptr unless this is an object with the key, or an array with the index
+		JsonData* TryAt(std::string_view Key) const;
+		JsonData* TryAt(size_t Index) const;
+
 		bool IsNull() const;
 
 		bool operator ==(const JsonData& c) const;
@@ -150,22 +419,135 @@ namespace JsonLibrary
 		inline operator uint64_t() const { return uint64_t(operator double()); }
 	};
 
-	using JsonObjectParentType = std::map<JsonString, JsonDataPtr>;
-	using JsonArrayParentType = std::vector<JsonDataPtr>;
+	// Whether the members of a JsonSourceObject or JsonSourceArray are still to be made, from its source span (deferred by
+	// JsonParseOptions::LazyDepth) or from its typed buffer, and the options to parse them with. The first accessor claims
+	// them and makes them while accessors racing it wait; later ones only read the flags.
+	class JsonLazyContent
+	{
+	protected:
+		mutable std::atomic<uint8_t> Flags;
+
+	public:
+		static constexpr uint8_t Pending = 1, TrackPositions = 2, AllowComments = 4, LazyNumbers = 8, TypedArrays = 16;
+		static constexpr uint8_t Typed = 32, Loading = 64;
+
+		JsonLazyContent() : Flags(0) {}
+
+		uint8_t Get() const { return Flags.load(std::memory_order_acquire); }
+		void Set(uint8_t f) const { Flags.store(f, std::memory_order_release); }
+
+		// The flags to make the members with, with Loading added, or 0 once they are made or when the flags have Unless;
+		// waits while another claim is held
+		uint8_t Claim(uint8_t Unless = 0) const;
+		// Ends a claim with the flags to leave, 0 once the members are made, and wakes those waiting
+		void Release(uint8_t f) const;
+	};
+
+	using JsonStringParentType = std::basic_string<char, std::char_traits<char>, JsonAllocator<char>>;
+	// std::less<> lets keys be looked up by std::string_view and const char* without building a JsonString
+	using JsonObjectParentType = std::map<JsonString, JsonDataPtr, std::less<>, JsonAllocator<std::pair<const JsonString, JsonDataPtr>>>;
+	using JsonArrayParentType = std::vector<JsonDataPtr, JsonAllocator<JsonDataPtr>>;
+
+	// The elements of an array parsed with JsonParseOptions::TypedArrays, read in place without making nodes.
+	// Never modified once made, so copies of the array share it.
+	class JsonTypedElements
+	{
+	public:
+		// Numbers, numbers that were all integer literals within int64_t (kept exactly), or booleans
+		enum class ElementType : uint8_t { Number, Integer, Boolean };
+
+	protected:
+		std::vector<double, JsonAllocator<double>> Numbers; // Number and Boolean elements, booleans as 0 and 1
+		std::vector<int64_t, JsonAllocator<int64_t>> Integers;
+		ElementType Type;
+
+	public:
+		JsonTypedElements(const double* First, const double* Last, bool Booleans, const JsonAllocatorType& Alloc);
+		JsonTypedElements(const int64_t* First, const int64_t* Last, const JsonAllocatorType& Alloc);
+
+		ElementType GetElementType() const { return Type; }
+		size_t size() const { return Type == ElementType::Integer ? Integers.size() : Numbers.size(); }
+		bool empty() const { return !size(); }
+
+		// What the JsonNumber or JsonBoolean made for the element would hold
+		double GetNumber(size_t Index) const { return Type == ElementType::Integer ? static_cast<double>(Integers[Index]) : Numbers[Index]; }
+		bool GetBoolean(size_t Index) const { return GetNumber(Index) != 0; }
+		// Exact for Integer elements; the others convert like operator int64_t() of their node
+		int64_t GetInteger(size_t Index) const { return Type == ElementType::Integer ? Integers[Index] : static_cast<int64_t>(Numbers[Index]); }
+
+		// All the elements at once: those of the Number and Boolean types, and those of the Integer type
+		std::span<const double> GetNumbers() const { return Numbers; }
+		std::span<const int64_t> GetIntegers() const { return Integers; }
+
+		// The JsonNumber or JsonBoolean for the element, without a position
+		JsonDataPtr MakeNode(size_t Index, const JsonAllocatorType& Alloc) const;
+	};
 
 	class JsonObject : public JsonData, public JsonObjectParentType
 	{
+		friend class JsonData;
+
+	protected:
+		void Load() const { if (Extended) LoadMembers(); }
+		void LoadMembers() const;
+		static const JsonObjectParentType& Loaded(const JsonObject& c) { c.Load(); return c; }
+
+		JsonObject(const JsonData& Position, const JsonAllocatorType& Alloc); // No members, the position of another node
+
 	public:
 		JsonObject(size_t FromLineNo = 0, size_t FromColumn = 0);
+		JsonObject(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc);
+		explicit JsonObject(const JsonAllocatorType& Alloc);
 		JsonObject(const JsonObjectParentType& c, size_t FromLineNo, size_t FromColumn);
-		JsonObject(const JsonObject& c) = default;
+		JsonObject(const JsonObject& c);
+		JsonObject(const JsonObject& c, const JsonAllocatorType& Alloc);
+		~JsonObject();
 
 		virtual std::string ToString(int indent = 0, int cur_indent = 0, const std::string& indent_type = " ") const override;
 		virtual JsonDataPtr Copy() const override;
+		virtual size_t Hash() const override;
+		// Empty unless this is a JsonSourceObject that keeps one
+		const JsonSourceSpan& GetSourceSpan() const;
 
 		bool operator ==(const JsonObject& c) const;
 		bool operator !=(const JsonObject& c) const;
 
+		// Members of the map that hand out iterators, shadowed to parse the members of a lazy object first.
+		// They keep the source span; see Invalidate() for writing through what they return.
+		iterator begin() { Load(); return JsonObjectParentType::begin(); }
+		iterator end() { Load(); return JsonObjectParentType::end(); }
+		reverse_iterator rbegin();
+		reverse_iterator rend();
+		template<typename K> iterator find(const K& Key) { Load(); return JsonObjectParentType::find(Key); }
+
+		// Mutating members of the map, shadowed to drop the source span (which also parses the members of a lazy object)
+		template<typename... Args> auto insert(Args&&... args) { Invalidate(); return JsonObjectParentType::insert(std::forward<Args>(args)...); }
+		std::pair<iterator, bool> insert(value_type&& Value);
+		void insert(std::initializer_list<value_type> List);
+		template<typename... Args> auto insert_or_assign(Args&&... args) { Invalidate(); return JsonObjectParentType::insert_or_assign(std::forward<Args>(args)...); }
+		template<typename... Args> auto emplace(Args&&... args) { Invalidate(); return JsonObjectParentType::emplace(std::forward<Args>(args)...); }
+		template<typename... Args> auto emplace_hint(Args&&... args) { Invalidate(); return JsonObjectParentType::emplace_hint(std::forward<Args>(args)...); }
+		template<typename... Args> auto try_emplace(Args&&... args) { Invalidate(); return JsonObjectParentType::try_emplace(std::forward<Args>(args)...); }
+		template<typename... Args> auto erase(Args&&... args) { Invalidate(); return JsonObjectParentType::erase(std::forward<Args>(args)...); }
+		template<typename... Args> auto extract(Args&&... args) { Invalidate(); return JsonObjectParentType::extract(std::forward<Args>(args)...); }
+		void clear() { Invalidate(); JsonObjectParentType::clear(); }
+		void swap(JsonObject& c) { Invalidate(); c.Invalidate(); JsonObjectParentType::swap(c); }
+
+		// Reading members of the map, shadowed to parse the members of a lazy object first.
+		// The others see no members until one of these or a mutating member was called.
+		const_iterator begin() const { Load(); return JsonObjectParentType::begin(); }
+		const_iterator end() const { Load(); return JsonObjectParentType::end(); }
+		const_iterator cbegin() const { Load(); return JsonObjectParentType::cbegin(); }
+		const_iterator cend() const { Load(); return JsonObjectParentType::cend(); }
+		const_reverse_iterator rbegin() const;
+		const_reverse_iterator rend() const;
+		const_reverse_iterator crbegin() const;
+		const_reverse_iterator crend() const;
+		size_type size() const { Load(); return JsonObjectParentType::size(); }
+		bool empty() const { Load(); return JsonObjectParentType::empty(); }
+		template<typename K> const_iterator find(const K& Key) const { Load(); return JsonObjectParentType::find(Key); }
+		template<typename K> size_type count(const K& Key) const { Load(); return JsonObjectParentType::count(Key); }
+
 		template<typename T> bool contains(T Key) const;
 		template<typename T> const JsonDataPtr& at(T Key) const;
 		template<typename T> JsonDataPtr& operator [] (T Key);
@@ -186,19 +568,111 @@ namespace JsonLibrary
 	extern template bool JsonObject::contains(const char* Key) const;
 	extern template const JsonDataPtr& JsonObject::at(const char* Key) const;
 
+	extern template JsonDataPtr& JsonObject::operator [] (std::string Key);
+	extern template bool JsonObject::contains(std::string Key) const;
+	extern template const JsonDataPtr& JsonObject::at(std::string Key) const;
+
+	extern template JsonDataPtr& JsonObject::operator [] (std::string_view Key);
+	extern template bool JsonObject::contains(std::string_view Key) const;
+	extern template const JsonDataPtr& JsonObject::at(std::string_view Key) const;
+
+	// An object made by the parser with RetainSource or LazyDepth, which keeps the input it was parsed from, or has only
+	// that until its members are first accessed. Other objects are plain JsonObjects and pay for neither.
+	// Copy() keeps the span and a deferred copy parses its own members; copying into a plain JsonObject drops both.
+	class JsonSourceObject : public JsonObject
+	{
+		friend class JsonData;
+		friend class JsonObject;
+
+	protected:
+		JsonSourceSpan SourceSpan;
+		JsonLazyContent Lazy;
+
+	public:
+		JsonSourceObject(size_t FromLineNo = 0, size_t FromColumn = 0);
+		JsonSourceObject(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc);
+		JsonSourceObject(const JsonSourceObject& c);
+
+		virtual JsonDataPtr Copy() const override;
+		virtual void Invalidate() override;
+	};
+
 	class JsonArray : public JsonData, public JsonArrayParentType
 	{
+		friend class JsonData;
+
+	protected:
+		void Load() const { if (Extended) LoadMembers(); }
+		void LoadMembers(bool KeepTyped = false) const;
+		static const JsonArrayParentType& Loaded(const JsonArray& c) { c.Load(); return c; }
+		size_type LoadedSize() const;
+		std::shared_ptr<const JsonTypedElements> LoadTypedElements() const;
+
+		JsonArray(const JsonData& Position, const JsonAllocatorType& Alloc); // No elements, the position of another node
+		JsonArray(const JsonArray& c, std::shared_ptr<const JsonTypedElements> Typed);
+
 	public:
 		JsonArray(size_t FromLineNo = 0, size_t FromColumn = 0);
+		JsonArray(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc);
+		explicit JsonArray(const JsonAllocatorType& Alloc);
 		JsonArray(const JsonArrayParentType& c, size_t FromLineNo, size_t FromColumn);
-		JsonArray(const JsonArray& c) = default;
+		JsonArray(const JsonArray& c); // A typed array is copied into nodes; Copy() keeps it typed
+		JsonArray(const JsonArray& c, const JsonAllocatorType& Alloc);
+		~JsonArray();
 
 		virtual std::string ToString(int indent = 0, int cur_indent = 0, const std::string& indent_type = " ") const override;
 		virtual JsonDataPtr Copy() const override;
+		virtual size_t Hash() const override;
+		// Empty unless this is a JsonSourceArray that keeps one
+		const JsonSourceSpan& GetSourceSpan() const;
+
+		// The elements of an array parsed with JsonParseOptions::TypedArrays, for reading them without making their nodes,
+		// nullptr for other arrays and once an element was accessed as a node. The buffer stays valid while held.
+		std::shared_ptr<const JsonTypedElements> ShareTypedElements() const { return Extended ? LoadTypedElements() : nullptr; }
 
 		bool operator ==(const JsonArray& c) const;
 		bool operator !=(const JsonArray& c) const;
 
+		// Members of the vector that hand out iterators and references, shadowed to parse the members of a lazy array first.
+		// They keep the source span; see Invalidate() for writing through what they return.
+		iterator begin() { Load(); return JsonArrayParentType::begin(); }
+		iterator end() { Load(); return JsonArrayParentType::end(); }
+		reverse_iterator rbegin() { Load(); return JsonArrayParentType::rbegin(); }
+		reverse_iterator rend() { Load(); return JsonArrayParentType::rend(); }
+		reference front() { Load(); return JsonArrayParentType::front(); }
+		reference back() { Load(); return JsonArrayParentType::back(); }
+		pointer data() { Load(); return JsonArrayParentType::data(); }
+
+		// Mutating members of the vector, shadowed to drop the source span (which also parses the members of a lazy array)
+		void push_back(const value_type& Value) { Invalidate(); JsonArrayParentType::push_back(Value); }
+		void push_back(value_type&& Value) { Invalidate(); JsonArrayParentType::push_back(std::move(Value)); }
+		template<typename... Args> reference emplace_back(Args&&... args) { Invalidate(); return JsonArrayParentType::emplace_back(std::forward<Args>(args)...); }
+		template<typename... Args> auto emplace(Args&&... args) { Invalidate(); return JsonArrayParentType::emplace(std::forward<Args>(args)...); }
+		template<typename... Args> auto insert(Args&&... args) { Invalidate(); return JsonArrayParentType::insert(std::forward<Args>(args)...); }
+		iterator insert(const_iterator Pos, std::initializer_list<value_type> List) { Invalidate(); return JsonArrayParentType::insert(Pos, List); }
+		template<typename... Args> auto erase(Args&&... args) { Invalidate(); return JsonArrayParentType::erase(std::forward<Args>(args)...); }
+		template<typename... Args> void assign(Args&&... args) { Invalidate(); JsonArrayParentType::assign(std::forward<Args>(args)...); }
+		template<typename... Args> void resize(Args&&... args) { Invalidate(); JsonArrayParentType::resize(std::forward<Args>(args)...); }
+		void pop_back() { Invalidate(); JsonArrayParentType::pop_back(); }
+		void clear() { Invalidate(); JsonArrayParentType::clear(); }
+		void swap(JsonArray& c) { Invalidate(); c.Invalidate(); JsonArrayParentType::swap(c); }
+
+		// Reading members of the vector, shadowed to parse the members of a lazy array first, and to make the nodes of a
+		// typed one. The others see no members until one of these or a mutating member was called.
+		const_iterator begin() const { Load(); return JsonArrayParentType::begin(); }
+		const_iterator end() const { Load(); return JsonArrayParentType::end(); }
+		const_iterator cbegin() const { Load(); return JsonArrayParentType::cbegin(); }
+		const_iterator cend() const { Load(); return JsonArrayParentType::cend(); }
+		const_reverse_iterator rbegin() const { Load(); return JsonArrayParentType::rbegin(); }
+		const_reverse_iterator rend() const { Load(); return JsonArrayParentType::rend(); }
+		const_reverse_iterator crbegin() const { Load(); return JsonArrayParentType::crbegin(); }
+		const_reverse_iterator crend() const { Load(); return JsonArrayParentType::crend(); }
+		const_reference front() const { Load(); return JsonArrayParentType::front(); }
+		const_reference back() const { Load(); return JsonArrayParentType::back(); }
+		const value_type* data() const { Load(); return JsonArrayParentType::data(); }
+		size_type size() const { return Extended ? LoadedSize() : JsonArrayParentType::size(); } // A typed array keeps its nodes unmade
+		bool empty() const { return !size(); }
+
 		JsonDataPtr& operator [] (const std::string& Key);
 		const JsonDataPtr& at(const std::string& Key) const;
 
@@ -210,15 +684,49 @@ namespace JsonLibrary
 		virtual operator double() const override;
 	};
 
-	class JsonString : public JsonData, public std::string
+	// An array made by the parser with RetainSource, LazyDepth or TypedArrays, which keeps the input it was parsed from, has
+	// only that until its elements are first accessed, or keeps them as a typed buffer until they are accessed as nodes.
+	// Other arrays are plain JsonArrays and pay for none of it.
+	// Copy() keeps the span and shares the buffer, and a deferred copy parses its own elements.
+	class JsonSourceArray : public JsonArray
+	{
+		friend class JsonData;
+		friend class JsonArray;
+
+	protected:
+		JsonSourceSpan SourceSpan;
+		JsonLazyContent Lazy;
+		// Dropped once the nodes are made; readers that loaded it keep it alive
+		mutable std::atomic<std::shared_ptr<const JsonTypedElements>> TypedElements;
+
+	public:
+		JsonSourceArray(size_t FromLineNo = 0, size_t FromColumn = 0);
+		JsonSourceArray(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc);
+		JsonSourceArray(const JsonSourceArray& c);
+
+		virtual JsonDataPtr Copy() const override;
+		virtual void Invalidate() override;
+	};
+
+	class JsonString : public JsonData, public JsonStringParentType
 	{
 	public:
 		JsonString(size_t FromLineNo = 0, size_t FromColumn = 0);
-		JsonString(const std::string& Value, size_t FromLineNo, size_t FromColumn);
+		JsonString(size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc);
+		explicit JsonString(const JsonAllocatorType& Alloc);
+		JsonString(std::string_view Value, size_t FromLineNo, size_t FromColumn);
+		JsonString(std::string_view Value, size_t FromLineNo, size_t FromColumn, const JsonAllocatorType& Alloc);
 		JsonString(const JsonString& c) = default;
+		JsonString(JsonString&& c) = default;
+		JsonString(const JsonString& c, const JsonAllocatorType& Alloc);
+		JsonString(JsonString&& c, const JsonAllocatorType& Alloc);
+
+		JsonString& operator = (const JsonString& c) = default;
+		JsonString& operator = (JsonString&& c) = default;
 
 		virtual std::string ToString(int indent = 0, int cur_indent = 0, const std::string& indent_type = " ") const override;
 		virtual JsonDataPtr Copy() const override;
+		virtual size_t Hash() const override;
 
 		bool operator ==(const JsonString& c) const;
 		bool operator !=(const JsonString& c) const;
@@ -247,6 +755,7 @@ namespace JsonLibrary
 
 		virtual std::string ToString(int indent = 0, int cur_indent = 0, const std::string& indent_type = " ") const override;
 		virtual JsonDataPtr Copy() const override;
+		virtual size_t Hash() const override;
 
 		bool operator ==(const JsonNumber& c) const;
 		bool operator !=(const JsonNumber& c) const;
@@ -257,6 +766,30 @@ namespace JsonLibrary
 		virtual JsonDataPtr& operator [] (size_t Index) override;
 		virtual const JsonDataPtr& at(size_t Index) const override;
 		virtual operator double() const override;
+
+		// The literal the number was parsed from, empty unless it was kept (see JsonParseOptions::LazyNumbers)
+		virtual std::string_view GetLiteral() const;
+	};
+
+	// A number parsed with JsonParseOptions::LazyNumbers, whose literal is stored after the node so that others keep their size.
+	// The literal stands for the number while Value still holds what it was parsed to; serializing writes it as it was.
+	class JsonLazyNumber : public JsonNumber
+	{
+	public:
+		static constexpr size_t MaxLiteral = 22;
+
+	protected:
+		double Parsed;
+		uint8_t Size;
+		char Literal[MaxLiteral];
+
+	public:
+		// For a literal of at most MaxLiteral bytes that matches the number grammar and converts to Value
+		JsonLazyNumber(std::string_view Literal, double Value, size_t FromLineNo, size_t FromColumn);
+		JsonLazyNumber(const JsonLazyNumber& c) = default;
+
+		virtual JsonDataPtr Copy() const override;
+		virtual std::string_view GetLiteral() const override;
 	};
 
 	class JsonBoolean : public JsonData
@@ -271,6 +804,7 @@ namespace JsonLibrary
 		operator bool() const { return Value; }
 		virtual std::string ToString(int indent = 0, int cur_indent = 0, const std::string& indent_type = " ") const override;
 		virtual JsonDataPtr Copy() const override;
+		virtual size_t Hash() const override;
 
 		bool operator ==(const JsonBoolean& c) const;
 		bool operator !=(const JsonBoolean& c) const;
@@ -291,6 +825,7 @@ namespace JsonLibrary
 
 		virtual std::string ToString(int indent = 0, int cur_indent = 0, const std::string& indent_type = " ") const override;
 		virtual JsonDataPtr Copy() const override;
+		virtual size_t Hash() const override;
 
 		bool operator ==(const JsonNull& c) const;
 		bool operator !=(const JsonNull& c) const;
@@ -308,6 +843,11 @@ namespace JsonLibrary
 	JsonPtr<T> MakeJsonPtr(Args && ... args)
 	{ return std::make_shared<T>(args...); }
 
+	// Allocates the node itself from `Alloc`; object, array and string nodes also get `Alloc` for their contents.
+	template<class T, class ... Args>
+	JsonPtr<T> AllocateJsonPtr(const JsonAllocatorType& Alloc, Args && ... args)
+	{ return std::allocate_shared<T>(JsonAllocator<T>(Alloc), std::forward<Args>(args)...); }
+
 	template<class ... Args>
 	JsonPtr<JsonData> MakeJsonDataPtr(Args && ... args)
 	{ return MakeJsonPtr<JsonData>(args...); }
@@ -336,11 +876,400 @@ namespace JsonLibrary
 	JsonPtr<JsonNull> MakeJsonNullPtr(Args && ... args)
 	{ return MakeJsonPtr<JsonNull>(args...); }
 
-	JsonDataPtr ParseJsonFromString(const std::string& s);
-	JsonDataPtr ParseJsonFromFile(const std::string& FilePath);
+	JsonDataPtr ParseJsonFromString(const std::string& s, const JsonAllocatorType& Alloc = {});
+	JsonDataPtr ParseJsonFromFile(const std::string& FilePath, const JsonAllocatorType& Alloc = {});
+	JsonDataPtr ParseJsonFromString(const std::string& s, const JsonParseOptions& Options, const JsonAllocatorType& Alloc = {});
+	JsonDataPtr ParseJsonFromFile(const std::string& FilePath, const JsonParseOptions& Options, const JsonAllocatorType& Alloc = {});
+
+	struct JsonWriteOptions
+	{
+		int Indent = 0;
+		std::string IndentType = " ";
+
+		// Write to a temporary file of a name no other writer uses next to FilePath, and rename it over FilePath once complete,
+		// so readers never see a partial file. The new file keeps the permissions, and where allowed the owner, of the old one.
+		// Without it FilePath is truncated and written in place: readers can see it partly written, and a failure leaves it so.
+		bool Atomic = true;
+
+		// fsync() the file before returning, and with Atomic also the directory after the rename; either failing throws
+		bool Sync = false;
+
+		size_t BufferSize = 1 << 20;
+	};
+
+	// Writes what ToString() returns to a file, serializing through a fixed buffer instead of building the whole text in memory
+	void WriteJsonToFile(const JsonData& Json, const std::string& FilePath, const JsonWriteOptions& Options = {});
+
+	// Report malformed input through the result instead of throwing
+	JsonParseResult TryParseJsonFromString(const std::string& s, const JsonParseOptions& Options = {}, const JsonAllocatorType& Alloc = {});
+	JsonParseResult TryParseJsonFromString(std::shared_ptr<const std::string> s, const JsonParseOptions& Options = {}, const JsonAllocatorType& Alloc = {});
+	JsonParseResult TryParseJsonFromFile(const std::string& FilePath, const JsonParseOptions& Options = {}, const JsonAllocatorType& Alloc = {});
+
+#ifdef JSON_USE_PMR
+	// A buffer the caller owns and no longer needs, for parsing in situ with ParseJsonInSitu(). Strings are decoded over their
+	// own text, and the string nodes and keys made from them keep their characters right there instead of allocating them;
+	// everything else is allocated from Upstream. The parse destroys the text, so a buffer is parsed once.
+	// Like any memory resource, it and the buffer must outlive the documents. A string that outgrows its place later
+	// moves to Upstream.
+	class JsonInSituResource : public std::pmr::memory_resource
+	{
+	protected:
+		char* Buffer;
+		size_t Size;
+		std::pmr::memory_resource* Upstream;
+
+		// Where the characters of the next string go, set by the parser while it makes the string
+		char* Expected;
+		size_t ExpectedBytes;
+
+		friend class JsonParser;
+		friend class JsonData;
+
+		virtual void* do_allocate(size_t Bytes, size_t Alignment) override;
+		virtual void do_deallocate(void* p, size_t Bytes, size_t Alignment) override;
+		virtual bool do_is_equal(const std::pmr::memory_resource& Other) const noexcept override;
+
+	public:
+		JsonInSituResource(char* Buffer, size_t Size, std::pmr::memory_resource* Upstream = std::pmr::get_default_resource());
+		JsonInSituResource(const JsonInSituResource& c) = delete;
+	};
+
+	// Parses the buffer of Resource in situ. RetainSource and LazyDepth are ignored, since both need the text the parse
+	// destroys; on failure the buffer is left partly rewritten.
+	JsonDataPtr ParseJsonInSitu(JsonInSituResource& Resource, const JsonParseOptions& Options = {});
+	JsonParseResult TryParseJsonInSitu(JsonInSituResource& Resource, const JsonParseOptions& Options = {});
+#endif
+
+	// A parser kept alive across documents, for one thread parsing many small ones. Its scratch buffers (the stacks of
+	// open containers and array elements, typed-array values and decoded strings) keep their capacity from one parse
+	// to the next, up to MaxRetainedBytes each.
+	// Documents come from Alloc like those of ParseJsonFromString, so they may outlive the parser and be handed to a
+	// JsonReclaimer. With JSON_USE_PMR, PoolNodes allocates them from the parser's own pool instead, where the nodes of
+	// documents already destroyed are reused so that steady-state parsing doesn't reach the heap. The pool isn't
+	// thread-safe: those documents must be made and destroyed on one thread, before the parser is, and so must never be
+	// given to a JsonReclaimer. Builds without NDEBUG assert both.
+	class JsonReusableParser
+	{
+	protected:
+#ifdef JSON_USE_PMR
+		std::unique_ptr<std::pmr::memory_resource> Pool; // With PoolNodes only
+#endif
+		std::unique_ptr<JsonParser> Parser;
+
+		JsonParseResult Run(std::string_view s, std::shared_ptr<const std::string> Source);
+
+	public:
+		JsonParseOptions Options;
+		size_t MaxRetainedBytes;
+
+		JsonReusableParser(const JsonParseOptions& Options = {}, size_t MaxRetainedBytes = 1 << 16, const JsonAllocatorType& Alloc = {});
+#ifdef JSON_USE_PMR
+		JsonReusableParser(const JsonParseOptions& Options, size_t MaxRetainedBytes, bool PoolNodes);
+#endif
+		JsonReusableParser(const JsonReusableParser& c) = delete;
+		~JsonReusableParser();
+
+		JsonDataPtr Parse(std::string_view s);
+		JsonParseResult TryParse(std::string_view s);
+		// Shares s with deferred containers and RetainSource spans instead of copying it
+		JsonParseResult TryParse(std::shared_ptr<const std::string> s);
+	};
+
+	// Checks that the input is well-formed JSON accepted by the parser, without building or allocating anything.
+	// Numbers are only checked against the grammar, so a literal too large for a double passes here.
+	// The result never holds a value; on failure it holds the first error.
+	JsonParseResult ValidateJson(std::string_view s, const JsonValidateOptions& Options = {});
+
+	struct JsonSchemaProgram;
+
+	// A JSON Schema compiled for validating documents while they are read.
+	// Supports boolean schemas and the keywords type, enum, const, properties, required, additionalProperties, items,
+	// minimum, maximum, exclusiveMinimum, exclusiveMaximum, minLength, maxLength, pattern, minItems, maxItems,
+	// minProperties and maxProperties. Annotations and unknown keywords are ignored; the other applicators
+	// ($ref, allOf, anyOf, if, prefixItems, ...) throw JsonSchemaError, as does an enum or const that is an object or array.
+	class JsonSchema
+	{
+	protected:
+		std::shared_ptr<const JsonSchemaProgram> Program;
+
+	public:
+		JsonSchema(const JsonData& Schema);
+
+		// Checks the text against the schema in one pass without building it, stopping at the first violation.
+		// Malformed input gives the same errors as ValidateJson().
+		JsonParseResult Validate(std::string_view s, const JsonValidateOptions& Options = {}) const;
+
+		// Checks a parsed document; on failure LineNo and Column are those of the offending node.
+		JsonParseResult Validate(const JsonData& Json) const;
+
+		// Parses the text only if it passes Validate(), so rejected documents allocate nothing
+		JsonParseResult Parse(const std::string& s, const JsonParseOptions& Options = {}, const JsonAllocatorType& Alloc = {}) const;
+	};
+
+	// Like ToString(), but objects and arrays that still have their source span are written as the original input bytes.
+	// Only the modified parts are formatted; the spliced parts keep the whitespace and number spelling of the input.
+	std::string ToStringSpliced(const JsonData& Json, int indent = 0, const std::string& indent_type = " ");
+
+	// Strings are written with every non-ASCII character escaped as \uXXXX, which keeps the output plain ASCII.
+	// While a JsonUtf8OutputScope is alive, serialization on its thread (and the workers of ToStringParallel()) writes them as UTF-8 instead.
+	class JsonUtf8OutputScope
+	{
+	protected:
+		bool Saved;
+
+	public:
+		JsonUtf8OutputScope(bool Enable = true);
+		~JsonUtf8OutputScope();
+	};
+
+	// Worker threads kept for the parallel serializers, so that a call doesn't start threads of its own.
+	// Several calls may share a pool; each call also works on its own tasks on the thread that made it.
+	class JsonTaskPool
+	{
+	protected:
+		std::mutex Lock;
+		std::condition_variable Ready; // Something was queued, or the pool is stopping
+		std::deque<std::function<void()>> Queue;
+		bool Stopping;
+		std::vector<std::thread> Workers;
+
+		void Run();
+
+	public:
+		// 0 for one worker less than std::thread::hardware_concurrency(), leaving a core to the caller
+		JsonTaskPool(size_t Threads = 0);
+		JsonTaskPool(const JsonTaskPool& c) = delete;
+
+		// Runs what is still queued before returning
+		~JsonTaskPool();
+
+		size_t GetThreads() const;
+
+		// Runs Task on a worker, or right here for a pool without workers; it must not throw
+		void Submit(std::function<void()> Task);
+
+		// The pool used when none is given, started on first use
+		static JsonTaskPool& GetDefault();
+	};
+
+	struct JsonParallelOptions
+	{
+		size_t Threads = 0; // Threads working on one call, the caller's included; 0 for all of Pool's and the caller
+		size_t ChunkNodes = 16384; // Nodes serialized per task; smaller containers are never split
+		JsonTaskPool* Pool = nullptr; // nullptr for JsonTaskPool::GetDefault()
+	};
+
+	// Same output as ToString(), but large objects and arrays are cut into ranges of members that are serialized on the workers
+	// of a JsonTaskPool while the rest of the document is still being cut up.
+	// With one thread, or fewer than 2 * ChunkNodes nodes, it is ToString().
+	// The document must not be modified while this runs.
+	std::string ToStringParallel(const JsonData& Json, int indent = 0, const std::string& indent_type = " ", const JsonParallelOptions& Options = {});
+
+	// Like ToStringParallel(), but passes the text to Sink in order, a chunk at a time as soon as it and those before it are done,
+	// without building the whole text; Sink is called on the calling thread only
+	void WriteJsonParallel(const JsonData& Json, const std::function<void(std::string_view)>& Sink, int indent = 0, const std::string& indent_type = " ", const JsonParallelOptions& Options = {});
+
+	// WriteJsonToFile() through WriteJsonParallel(), writing each chunk to the file as it is done
+	void WriteJsonToFile(const JsonData& Json, const std::string& FilePath, const JsonWriteOptions& Options, const JsonParallelOptions& Parallel);
+
+	// The canonical form of RFC 8785 (JCS), for hashing or signing documents: no whitespace, members sorted by the UTF-16 code units
+	// of their names, numbers in the shortest form that reads back the same written as ECMAScript does, and strings as UTF-8 with
+	// only '"', '\\' and control characters escaped. Equal documents give the same bytes.
+	// Throws JsonEncodeError for values JCS has no form for, and UnicodeDecodeError for strings that are not valid UTF-8.
+	std::string ToStringCanonical(const JsonData& Json);
+
+	// Passes the canonical form to Sink in pieces of about BufferSize bytes, e.g. into an incremental hash, without building the whole text
+	void WriteJsonCanonical(const JsonData& Json, const std::function<void(std::string_view)>& Sink, size_t BufferSize = 1 << 12);
 
 	JsonDataPtr Copy(JsonDataPtr Json);
 	JsonDataPtr Copy(const JsonData& Json);
+
+	// Hash-consing: replaces structurally equal subtrees by one shared node, so repeated objects, arrays and strings are stored once.
+	// Children are replaced in place, and since shared nodes are aliased the result must be treated as immutable
+	// (JsonCowDocument clones shared nodes before writing to them).
+	// Keeping one deduplicator alive across documents also shares equal subtrees between them.
+	class JsonDeduplicator
+	{
+	protected:
+		std::unordered_multimap<size_t, JsonDataPtr> Nodes;
+
+		JsonDataPtr Intern(const JsonDataPtr& Json, size_t Hash);
+
+	public:
+		JsonDataPtr Deduplicate(const JsonDataPtr& Json);
+
+		size_t size() const;
+		void clear();
+	};
+
+	JsonDataPtr Deduplicate(const JsonDataPtr& Json);
+
+	struct JsonDiffEntry
+	{
+		std::string Path; // JSON Pointer (RFC 6901) of the differing value
+		JsonDataPtr Old; // nullptr when the value was added
+		JsonDataPtr New; // nullptr when the value was removed
+	};
+
+	// Lists the differences between two documents. Subtrees both share, such as the unchanged parts of two
+	// JsonCowDocument snapshots, are skipped without looking into them; the others are compared node by node.
+	std::vector<JsonDiffEntry> DiffJson(const JsonDataPtr& Old, const JsonDataPtr& New);
+
+	// A writable slot of a JsonCowDocument.
+	// Going through it clones every node on the way that is still shared with a snapshot, so only the path from the root to the modified node is copied.
+	// References are invalidated by JsonCowDocument::Commit().
+	class JsonCowRef
+	{
+	protected:
+		JsonDataPtr& Slot;
+
+		JsonCowRef(JsonDataPtr& Slot);
+		JsonData& Unshare();
+
+		friend class JsonCowDocument;
+
+	public:
+		JsonCowRef operator [] (std::string_view Key);
+		JsonCowRef operator [] (size_t Index);
+
+		JsonCowRef& operator = (JsonDataPtr Value);
+
+		JsonData& operator * ();
+		JsonData* operator -> ();
+		operator JsonConstDataPtr () const;
+	};
+
+	// Copy-on-write document for one writer and any number of readers.
+	// Snapshot() is O(1) and returns the last committed version, which never changes afterwards.
+	// The writer edits through operator [] / Root() and publishes its changes with Commit().
+	class JsonCowDocument
+	{
+	protected:
+		mutable std::mutex Lock;
+		JsonDataPtr Published;
+		JsonDataPtr Working;
+
+	public:
+		JsonCowDocument(JsonDataPtr Root);
+		JsonCowDocument(const JsonCowDocument& c) = delete;
+
+		JsonConstDataPtr Snapshot() const;
+		void Commit();
+
+		JsonCowRef Root();
+		JsonCowRef operator [] (std::string_view Key);
+		JsonCowRef operator [] (size_t Index);
+	};
+
+	// Destroys dropped documents on a background thread, so that releasing a large tree only costs the thread
+	// that drops it a handoff. Documents allocated from a memory resource that isn't thread-safe must not be given to it.
+	class JsonReclaimer
+	{
+	protected:
+		std::mutex Lock;
+		std::condition_variable Ready; // Something was queued, or the reclaimer is stopping
+		std::condition_variable Progress; // Something was taken off the queue or destroyed
+		std::deque<JsonDataPtr> Queue;
+		size_t MaxQueued;
+		bool Busy;
+		bool Stopping;
+		std::thread Worker;
+
+		void Run();
+
+	public:
+		JsonReclaimer(size_t MaxQueued = 64);
+		JsonReclaimer(const JsonReclaimer& c) = delete;
+
+		// Destroys what is still queued before returning
+		~JsonReclaimer();
+
+		// Takes over Json and drops it on the background thread. A tree that is still referenced elsewhere is dropped here,
+		// since that only counts down. Blocks while MaxQueued trees are waiting to be destroyed.
+		void Reclaim(JsonDataPtr Json);
+
+		// Waits until everything reclaimed so far is destroyed
+		void Flush();
+	};
+
+	class JsonFrozenDocument;
+
+	// A value of a JsonFrozenDocument, or a missing value where a lookup found nothing.
+	// It is a plain handle: copying it touches no reference count. Valid while the document is alive.
+	class JsonFrozenValue
+	{
+	protected:
+		const JsonFrozenDocument* Document;
+		size_t Index;
+
+		JsonFrozenValue(const JsonFrozenDocument* Document, size_t Index);
+
+		friend class JsonFrozenDocument;
+
+	public:
+		JsonFrozenValue();
+
+		explicit operator bool() const; // false for a missing value
+		JsonDataType GetType() const; // Unknown for a missing value
+		bool IsNull() const;
+
+		// WrongDataType unless the value has the type
+		std::string_view AsString() const;
+		double AsNumber() const;
+		bool AsBoolean() const;
+
+		// Members of an object or elements of an array, 0 for the other types
+		size_t size() const;
+
+		// Missing unless this is an array or object with the index, or an object with the key, so lookups can be chained
+		JsonFrozenValue operator [] (size_t Index) const;
+		JsonFrozenValue operator [] (std::string_view Key) const;
+
+		// The member name when this value was reached through its object, empty otherwise
+		std::string_view GetKey() const;
+
+		// Builds an ordinary mutable tree from this value
+		JsonDataPtr Thaw() const;
+	};
+
+	// An immutable copy of a document laid out in two flat buffers: the nodes, with the children of each object or array
+	// next to each other (members sorted by name), and the text of the strings and member names.
+	// Any number of threads can read it at once without locks, and navigating it allocates and counts nothing.
+	class JsonFrozenDocument
+	{
+	protected:
+		struct Node
+		{
+			JsonDataType Type;
+			bool Boolean;
+			uint32_t KeySize;
+			size_t Key; // Offset of the member name in Text, for the members of an object
+			size_t Size; // Length of a string, or the number of children
+			union
+			{
+				double Number;
+				size_t Offset; // Of a string in Text, or of the first child in Nodes
+			};
+		};
+
+		std::vector<Node> Nodes;
+		std::string Text;
+
+		bool Fill(size_t At, const JsonData& Json);
+
+		friend class JsonFrozenValue;
+
+	public:
+		JsonFrozenDocument(const JsonData& Json);
+		JsonFrozenDocument(const JsonFrozenDocument& c) = delete;
+
+		JsonFrozenValue Root() const;
+		JsonFrozenValue operator [] (size_t Index) const;
+		JsonFrozenValue operator [] (std::string_view Key) const;
+	};
+
+	// Share the result between threads and navigate it through JsonFrozenValue
+	std::shared_ptr<const JsonFrozenDocument> Freeze(const JsonData& Json);
 }
 
 
@@ -0,0 +1,683 @@
+#include "json.hpp"
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Self-contained test runner for the JSON library, run by ctest.
+//
+// Usage: json_tests [--filter <substring>]
+
+using namespace JsonLibrary;
+
+static size_t Checks = 0;
+static size_t Failures = 0;
+
+static void Check(bool Passed, const char* Condition, const char* File, int Line)
+{
+	Checks++;
+	if (Passed) return;
+	Failures++;
+	printf("%s:%d: check failed: %s\n", File, Line, Condition);
+}
+
+#define CHECK(Condition) Check(static_cast<bool>(Condition), #Condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(Actual, Expected) Check((Actual) == (Expected), #Actual " == " #Expected, __FILE__, __LINE__)
+
+// ValidateJson() must agree with the parser on every input: the same verdict, error and offset
+static void CheckValidate(const std::string& s, JsonErrorCode Expected, const JsonValidateOptions& Options = {})
+{
+	JsonParseResult Checked = ValidateJson(s, Options);
+	CHECK(!Checked.Value);
+	CHECK_EQUAL(Checked.Error, Expected);
+	if (Checked.Error != Expected) printf("    for input: %s\n", s.c_str());
+
+	if (Options.MaxSize && s.size() > Options.MaxSize) return;
+	JsonParseOptions ParseOptions;
+	ParseOptions.AllowComments = Options.AllowComments;
+	ParseOptions.MaxDepth = Options.MaxDepth;
+	JsonParseResult Parsed = TryParseJsonFromString(s, ParseOptions);
+	CHECK_EQUAL(Parsed.Error, Checked.Error);
+	CHECK_EQUAL(Parsed.Offset, Checked.Offset);
+}
+
+static void TestValidateAccepts()
+{
+	CheckValidate("{}", JsonErrorCode::None);
+	CheckValidate(" [1, -0.5, 2e10, 3E-2, true, false, null, \"a\\n\\u00e9\\ud83d\\ude00\"] ", JsonErrorCode::None);
+	CheckValidate("{\"a\": {\"b\": [[], {}]}, \"c\": \"\xC3\xA9\"}", JsonErrorCode::None);
+	CheckValidate("// comment\n[1, /* two */ 2]", JsonErrorCode::None);
+	CheckValidate("", JsonErrorCode::None); // No value at all
+
+	// Only the grammar is checked, so a number too large for a double passes
+	CHECK_EQUAL(ValidateJson("1e999").Error, JsonErrorCode::None);
+	CHECK_EQUAL(TryParseJsonFromString("1e999").Error, JsonErrorCode::NumberOutOfRange);
+}
+
+static void TestValidateRejects()
+{
+	CheckValidate("[1, 2", JsonErrorCode::UnexpectedEnd);
+	CheckValidate("[1 2]", JsonErrorCode::UnexpectedCharacter);
+	CheckValidate("{\"a\" 1}", JsonErrorCode::ExpectedColon);
+	CheckValidate("{1: 2}", JsonErrorCode::KeyMustBeString);
+	CheckValidate("[-]", JsonErrorCode::ExpectedDigit);
+	CheckValidate("[1.]", JsonErrorCode::ExpectedDigit);
+	CheckValidate("[tru]", JsonErrorCode::InvalidLiteral);
+	CheckValidate("\"\\x\"", JsonErrorCode::InvalidEscape);
+	CheckValidate("\"a\tb\"", JsonErrorCode::InvalidControlCharacter);
+	CheckValidate("\"\xFF\"", JsonErrorCode::InvalidUtf8);
+	CheckValidate("[1] 2", JsonErrorCode::ExtraData);
+	CheckValidate("[1 /* open", JsonErrorCode::UnterminatedComment);
+
+	JsonValidateOptions NoComments;
+	NoComments.AllowComments = false;
+	CheckValidate("// comment\n1", JsonErrorCode::UnexpectedCharacter, NoComments);
+
+	JsonValidateOptions Shallow;
+	Shallow.MaxDepth = 2;
+	CheckValidate("[[1]]", JsonErrorCode::None, Shallow);
+	CheckValidate("[[[1]]]", JsonErrorCode::TooDeep, Shallow);
+
+	JsonValidateOptions Small;
+	Small.MaxSize = 4;
+	CheckValidate("[1]", JsonErrorCode::None, Small);
+	CheckValidate("[1, 2]", JsonErrorCode::TooLarge, Small);
+}
+
+struct SchemaCase
+{
+	const char* Schema;
+	const char* Document;
+	JsonSchemaKeyword Failure; // None where the document passes
+};
+
+static const SchemaCase SchemaCases[] =
+{
+	{ "true", "[1, {}]", JsonSchemaKeyword::None },
+	{ "false", "1", JsonSchemaKeyword::False },
+	{ "{\"type\": \"integer\"}", "3", JsonSchemaKeyword::None },
+	{ "{\"type\": \"integer\"}", "3.5", JsonSchemaKeyword::Type },
+	{ "{\"type\": [\"string\", \"null\"]}", "null", JsonSchemaKeyword::None },
+	{ "{\"type\": [\"string\", \"null\"]}", "false", JsonSchemaKeyword::Type },
+	{ "{\"type\": \"number\"}", "7", JsonSchemaKeyword::None },
+	{ "{\"enum\": [1, \"a\", null]}", "\"a\"", JsonSchemaKeyword::None },
+	{ "{\"enum\": [1, \"a\", null]}", "2", JsonSchemaKeyword::Enum },
+	{ "{\"const\": true}", "true", JsonSchemaKeyword::None },
+	{ "{\"const\": true}", "1", JsonSchemaKeyword::Const },
+	{ "{\"minimum\": 2}", "2", JsonSchemaKeyword::None },
+	{ "{\"minimum\": 2}", "1.5", JsonSchemaKeyword::Minimum },
+	{ "{\"maximum\": 2}", "2", JsonSchemaKeyword::None },
+	{ "{\"maximum\": 2}", "3", JsonSchemaKeyword::Maximum },
+	{ "{\"exclusiveMinimum\": 2}", "2.5", JsonSchemaKeyword::None },
+	{ "{\"exclusiveMinimum\": 2}", "2", JsonSchemaKeyword::ExclusiveMinimum },
+	{ "{\"exclusiveMaximum\": 2}", "1", JsonSchemaKeyword::None },
+	{ "{\"exclusiveMaximum\": 2}", "2", JsonSchemaKeyword::ExclusiveMaximum },
+	{ "{\"minLength\": 2}", "\"\u00e9\u00e9\"", JsonSchemaKeyword::None }, // Counted in characters, not bytes
+	{ "{\"minLength\": 2}", "\"\u00e9\"", JsonSchemaKeyword::MinLength },
+	{ "{\"maxLength\": 2}", "\"ab\"", JsonSchemaKeyword::None },
+	{ "{\"maxLength\": 2}", "\"abc\"", JsonSchemaKeyword::MaxLength },
+	{ "{\"pattern\": \"^a+$\"}", "\"aaa\"", JsonSchemaKeyword::None },
+	{ "{\"pattern\": \"^a+$\"}", "\"aba\"", JsonSchemaKeyword::Pattern },
+	{ "{\"minItems\": 2}", "[1, 2]", JsonSchemaKeyword::None },
+	{ "{\"minItems\": 2}", "[1]", JsonSchemaKeyword::MinItems },
+	{ "{\"maxItems\": 1}", "[1]", JsonSchemaKeyword::None },
+	{ "{\"maxItems\": 1}", "[1, 2]", JsonSchemaKeyword::MaxItems },
+	{ "{\"items\": {\"type\": \"string\"}}", "[\"a\", \"b\"]", JsonSchemaKeyword::None },
+	{ "{\"items\": {\"type\": \"string\"}}", "[\"a\", 2]", JsonSchemaKeyword::Type },
+	{ "{\"minProperties\": 1}", "{\"a\": 1}", JsonSchemaKeyword::None },
+	{ "{\"minProperties\": 1}", "{}", JsonSchemaKeyword::MinProperties },
+	{ "{\"maxProperties\": 1}", "{\"a\": 1}", JsonSchemaKeyword::None },
+	{ "{\"maxProperties\": 1}", "{\"a\": 1, \"b\": 2}", JsonSchemaKeyword::MaxProperties },
+	{ "{\"required\": [\"a\", \"b\"]}", "{\"b\": 1, \"a\": 2}", JsonSchemaKeyword::None },
+	{ "{\"required\": [\"a\", \"b\"]}", "{\"b\": 1}", JsonSchemaKeyword::Required },
+	{ "{\"properties\": {\"a\": {\"type\": \"number\"}}}", "{\"a\": 1, \"b\": \"x\"}", JsonSchemaKeyword::None },
+	{ "{\"properties\": {\"a\": {\"type\": \"number\"}}}", "{\"a\": \"1\"}", JsonSchemaKeyword::Type },
+	{ "{\"properties\": {\"a\": {}}, \"additionalProperties\": false}", "{\"a\": 1}", JsonSchemaKeyword::None },
+	{ "{\"properties\": {\"a\": {}}, \"additionalProperties\": false}", "{\"a\": 1, \"b\": 2}", JsonSchemaKeyword::AdditionalProperties },
+	{ "{\"additionalProperties\": {\"type\": \"boolean\"}}", "{\"a\": true}", JsonSchemaKeyword::None },
+	{ "{\"additionalProperties\": {\"type\": \"boolean\"}}", "{\"a\": 0}", JsonSchemaKeyword::Type },
+	{ "{\"title\": \"annotations and unknown keywords are ignored\", \"x-custom\": 1}", "[]", JsonSchemaKeyword::None },
+};
+
+// Each case through the streaming check, the check of a parsed document and the checked parse, which must agree
+static void TestSchemaKeywords()
+{
+	for (auto& Case : SchemaCases)
+	{
+		JsonSchema Schema(*ParseJsonFromString(Case.Schema));
+		JsonErrorCode Expected = Case.Failure == JsonSchemaKeyword::None ? JsonErrorCode::None : JsonErrorCode::SchemaViolation;
+
+		JsonParseResult Streamed = Schema.Validate(Case.Document);
+		JsonParseResult Walked = Schema.Validate(*ParseJsonFromString(Case.Document));
+		JsonParseResult Parsed = Schema.Parse(Case.Document);
+		for (auto* Result : { &Streamed, &Walked, &Parsed })
+		{
+			CHECK_EQUAL(Result->Error, Expected);
+			if (Expected != JsonErrorCode::None) CHECK_EQUAL(static_cast<JsonSchemaKeyword>(Result->Character), Case.Failure);
+			if (Result->Error != Expected) printf("    for schema %s and document %s\n", Case.Schema, Case.Document);
+		}
+		CHECK_EQUAL(static_cast<bool>(Parsed.Value), Expected == JsonErrorCode::None);
+	}
+
+	// A parsed document fails at the position of the offending node
+	JsonSchema Numbers(*ParseJsonFromString("{\"items\": {\"type\": \"number\"}}"));
+	JsonParseResult Result = Numbers.Validate(*ParseJsonFromString("[\n1,\n  \"x\"]"));
+	CHECK_EQUAL(Result.LineNo, 3u);
+	CHECK_EQUAL(Result.Column, 3u);
+}
+
+// Schemas that can't be checked in one pass are refused rather than half-checked
+static void TestSchemaUnsupported()
+{
+	for (const char* Schema : { "{\"$ref\": \"#\"}", "{\"anyOf\": [true]}", "{\"enum\": [[1]]}", "{\"minLength\": -1}", "{\"type\": \"date\"}", "[]" })
+	{
+		bool Thrown = false;
+		try
+		{
+			JsonSchema Compiled(*ParseJsonFromString(Schema));
+		}
+		catch (const JsonSchemaError&)
+		{
+			Thrown = true;
+		}
+		CHECK(Thrown);
+	}
+}
+
+// The number serialization samples of RFC 8785, given as the bits of the double
+static void TestCanonicalNumbers()
+{
+	static const struct
+	{
+		uint64_t Bits;
+		const char* Expected;
+	} Samples[] =
+	{
+		{ 0x0000000000000000, "0" },
+		{ 0x8000000000000000, "0" },
+		{ 0x0000000000000001, "5e-324" },
+		{ 0x8000000000000001, "-5e-324" },
+		{ 0x7fefffffffffffff, "1.7976931348623157e+308" },
+		{ 0xffefffffffffffff, "-1.7976931348623157e+308" },
+		{ 0x4340000000000000, "9007199254740992" },
+		{ 0xc340000000000000, "-9007199254740992" },
+		{ 0x4430000000000000, "295147905179352830000" },
+		{ 0x44b52d02c7e14af5, "9.999999999999997e+22" },
+		{ 0x44b52d02c7e14af6, "1e+23" },
+		{ 0x44b52d02c7e14af7, "1.0000000000000001e+23" },
+		{ 0x444b1ae4d6e2ef4e, "999999999999999700000" },
+		{ 0x444b1ae4d6e2ef4f, "999999999999999900000" },
+		{ 0x444b1ae4d6e2ef50, "1e+21" },
+		{ 0x3eb0c6f7a0b5ed8c, "9.999999999999997e-7" },
+		{ 0x3eb0c6f7a0b5ed8d, "0.000001" },
+		{ 0x41b3de4355555553, "333333333.3333332" },
+		{ 0x41b3de4355555554, "333333333.33333325" },
+		{ 0x41b3de4355555555, "333333333.3333333" },
+		{ 0x41b3de4355555556, "333333333.3333334" },
+		{ 0x41b3de4355555557, "333333333.33333343" },
+		{ 0xbecbf647612f3696, "-0.0000033333333333333333" },
+		{ 0x43143ff3c1cb0959, "1424953923781206.2" },
+	};
+	for (auto& Sample : Samples)
+	{
+		JsonNumber Number(std::bit_cast<double>(Sample.Bits), 0, 0);
+		std::string Canonical = ToStringCanonical(Number);
+		CHECK_EQUAL(Canonical, Sample.Expected);
+		if (Canonical != Sample.Expected) printf("    got %s\n", Canonical.c_str());
+	}
+
+	for (uint64_t Bits : { 0x7ff0000000000000ull, 0xfff0000000000000ull, 0x7ff8000000000000ull })
+	{
+		bool Thrown = false;
+		try
+		{
+			ToStringCanonical(JsonNumber(std::bit_cast<double>(Bits), 0, 0));
+		}
+		catch (const JsonEncodeError&)
+		{
+			Thrown = true;
+		}
+		CHECK(Thrown);
+	}
+}
+
+// The examples of RFC 8785 for the whole transformation, and for sorting members by UTF-16 code units
+static void TestCanonicalDocuments()
+{
+	auto Json = ParseJsonFromString(
+		"{\"numbers\": [333333333.33333329, 1E30, 4.50, 2e-3, 0.000000000000000000000000001],\n"
+		" \"string\": \"\\u20ac$\\u000F\\u000aA'\\u0042\\u0022\\u005c\\\\\\\"\\/\",\n"
+		" \"literals\": [null, true, false]}");
+	CHECK_EQUAL(ToStringCanonical(*Json),
+		"{\"literals\":[null,true,false],\"numbers\":[333333333.3333333,1e+30,4.5,0.002,1e-27],"
+		"\"string\":\"\xE2\x82\xAC$\\u000f\\nA'B\\\"\\\\\\\\\\\"/\"}");
+
+	// std::map orders the names by their UTF-8 bytes, which puts U+FB33 before the surrogate pair of U+1F600
+	Json = ParseJsonFromString(
+		"{\"\\u20ac\": 1, \"\\r\": 2, \"\\ufb33\": 3, \"1\": 4, \"\\ud83d\\ude00\": 5, \"\\u0080\": 6, \"\\u00f6\": 7}");
+	CHECK_EQUAL(ToStringCanonical(*Json),
+		"{\"\\r\":2,\"1\":4,\"\xC2\x80\":6,\"\xC3\xB6\":7,\"\xE2\x82\xAC\":1,\"\xF0\x9F\x98\x80\":5,\"\xEF\xAC\xB3\":3}");
+
+	// Streaming in small pieces gives the same bytes
+	std::string Streamed;
+	WriteJsonCanonical(*Json, [&](std::string_view Piece) { Streamed += Piece; }, 4);
+	CHECK_EQUAL(Streamed, ToStringCanonical(*Json));
+
+	// A lone surrogate has no UTF-8 form
+	bool Thrown = false;
+	try
+	{
+		ToStringCanonical(*ParseJsonFromString("\"\\ud83d\""));
+	}
+	catch (const std::exception&)
+	{
+		Thrown = true;
+	}
+	CHECK(Thrown);
+}
+
+// Equality and diffs must see every kind of write, including those to a descendant through a retained pointer,
+// through an iterator and through a number's Value, after the documents were hashed, compared and diffed before
+static void TestEqualityAfterMutation()
+{
+	auto a = ParseJsonFromString("{\"x\": {\"y\": 1}, \"z\": [1, 2]}");
+	auto b = ParseJsonFromString("{\"x\": {\"y\": 1}, \"z\": [1, 2]}");
+	auto c = ParseJsonFromString("{\"x\": {\"y\": 2}, \"z\": [1, 2]}");
+	auto x = b->at("x");
+	CHECK(DiffJson(a, b).empty());
+	CHECK(*a == *b);
+	CHECK(a->Hash() == b->Hash());
+	CHECK(*b != *c);
+	c->Hash();
+
+	x->AsJsonObject()["y"] = MakeJsonNumberPtr(2, 0, 0);
+	auto Diff = DiffJson(a, b);
+	CHECK_EQUAL(Diff.size(), 1u);
+	if (!Diff.empty()) CHECK_EQUAL(Diff[0].Path, "/x/y");
+	CHECK(*a != *b);
+	CHECK(*b == *c);
+	CHECK(b->Hash() == c->Hash());
+
+	b->at("x")->AsJsonObject().begin()->second = MakeJsonNumberPtr(1, 0, 0);
+	CHECK(DiffJson(a, b).empty());
+	CHECK(*a == *b);
+
+	b->at("z")->at(1)->AsJsonNumber().Value = 3;
+	Diff = DiffJson(a, b);
+	CHECK_EQUAL(Diff.size(), 1u);
+	if (!Diff.empty()) CHECK_EQUAL(Diff[0].Path, "/z/1");
+	CHECK(*a != *b);
+	CHECK(a->Hash() != b->Hash());
+
+	// Members added and removed
+	auto d = ParseJsonFromString("{\"x\": {\"y\": 1, \"w\": null}, \"z\": [1]}");
+	Diff = DiffJson(a, d);
+	CHECK_EQUAL(Diff.size(), 2u);
+	if (Diff.size() == 2)
+	{
+		CHECK(Diff[0].Path == "/x/w" && !Diff[0].Old && Diff[0].New);
+		CHECK(Diff[1].Path == "/z/1" && Diff[1].Old && !Diff[1].New);
+	}
+}
+
+// Documents nested far deeper than the stack could take in recursion go through everything that walks a tree
+static void TestDeepNesting()
+{
+	const size_t Depth = 200000;
+	std::string Text = std::string(Depth, '[') + "{\"a\": 1}" + std::string(Depth, ']');
+	JsonParseOptions Options;
+	Options.MaxDepth = SIZE_MAX;
+	auto a = ParseJsonFromString(Text, Options);
+	auto b = ParseJsonFromString(Text, Options);
+	CHECK(*a == *b);
+	CHECK(a->Hash() == b->Hash());
+	CHECK(DiffJson(a, b).empty());
+	CHECK_EQUAL(a->ToString(), Text.substr(0, Depth) + "{\"a\":1}" + Text.substr(Depth + 8));
+
+	// Change the innermost value
+	JsonData* Inner = b.get();
+	for (size_t i = 0; i < Depth; i++) Inner = Inner->AsJsonArray().at(0).get();
+	Inner->AsJsonObject()["a"] = MakeJsonNumberPtr(2, 0, 0);
+	CHECK(*a != *b);
+	CHECK(a->Hash() != b->Hash());
+	auto Diff = DiffJson(a, b);
+	CHECK_EQUAL(Diff.size(), 1u);
+	if (!Diff.empty()) CHECK_EQUAL(Diff[0].Path.size(), 2 * Depth + 2);
+
+	auto Frozen = Freeze(*a);
+	auto Thawed = Frozen->Root().Thaw();
+	CHECK(*Thawed == *a);
+
+	auto Shared = Deduplicate(b);
+	CHECK(*Shared == *b);
+
+	JsonSchema Passing(*ParseJsonFromString("{\"maxItems\": 1}"));
+	CHECK_EQUAL(Passing.Validate(*a).Error, JsonErrorCode::None);
+	JsonSchema Failing(*ParseJsonFromString("{\"items\": {\"items\": {\"type\": \"object\"}}}"));
+	CHECK_EQUAL(Failing.Validate(*a).Error, JsonErrorCode::SchemaViolation);
+}
+
+static void TestNumberLiterals()
+{
+	JsonParseOptions Options;
+	Options.LazyNumbers = true;
+	const std::string Text = "[0.10,12345678901234567890,-0,1.5e3,2,1234567890.1234567890123456]";
+	auto a = ParseJsonFromString(Text, Options);
+	// The last literal is too long to keep
+	CHECK_EQUAL(a->ToString(), "[0.10,12345678901234567890,-0,1.5e3,2,1234567890.123457]");
+	CHECK(*a == *ParseJsonFromString(Text));
+	CHECK_EQUAL(a->Copy()->ToString(), a->ToString());
+	CHECK_EQUAL(TryParseJsonFromString("[1e999]", Options).Error, JsonErrorCode::NumberOutOfRange);
+
+	auto& n = a->at(0)->AsJsonNumber();
+	double* p = &n.Value;
+	CHECK(*p == 0.1);
+	CHECK_EQUAL(n.GetLiteral(), "0.10");
+	n.Value += 1;
+	CHECK(n.GetLiteral().empty());
+	CHECK_EQUAL(n.ToString(), "1.100000");
+
+	// Only the same bits bring the literal back; -0 stays apart from 0
+	auto& z = a->at(2)->AsJsonNumber();
+	z.Value = 0;
+	CHECK(z.GetLiteral().empty());
+	z.Value = -0.0;
+	CHECK_EQUAL(z.GetLiteral(), "-0");
+
+	CHECK(ParseJsonFromString(Text)->at(1)->AsJsonNumber().GetLiteral().empty());
+}
+
+static void TestTypedArrays()
+{
+	JsonParseOptions Options;
+	Options.TypedArrays = true;
+	auto Ints = ParseJsonFromString("[9007199254740993,-2,0]", Options);
+	auto Typed = Ints->AsJsonArray().ShareTypedElements();
+	CHECK(Typed != nullptr);
+	if (Typed)
+	{
+		CHECK(Typed->GetElementType() == JsonTypedElements::ElementType::Integer);
+		CHECK_EQUAL(Typed->GetInteger(0), INT64_C(9007199254740993));
+		CHECK_EQUAL(Typed->GetIntegers().size(), 3u);
+	}
+	CHECK_EQUAL(Ints->ToString(), "[9007199254740993,-2,0]");
+	CHECK_EQUAL(Ints->AsJsonArray().size(), 3u);
+
+	// -0 and fractions keep the array on doubles, and it still equals its untyped parse
+	auto Numbers = ParseJsonFromString("[1,-0,2.5]", Options);
+	auto Doubles = Numbers->AsJsonArray().ShareTypedElements();
+	CHECK(Doubles && Doubles->GetElementType() == JsonTypedElements::ElementType::Number);
+	CHECK(*Numbers == *ParseJsonFromString("[1,-0,2.5]"));
+	CHECK(*ParseJsonFromString("[1,2]", Options) == *ParseJsonFromString("[1.0,2.0]", Options));
+
+	// Making the nodes drops the buffer, but a reader's share of it stays valid
+	CHECK(Ints->at(0)->AsJsonNumber().Value == 9007199254740992.0);
+	CHECK(Ints->AsJsonArray().ShareTypedElements() == nullptr);
+	if (Typed) CHECK_EQUAL(Typed->GetInteger(0), INT64_C(9007199254740993));
+
+	// Plain containers never carry the parser's extras
+	CHECK(sizeof(JsonArray) < sizeof(JsonSourceArray));
+	CHECK(sizeof(JsonObject) < sizeof(JsonSourceObject));
+	CHECK(ParseJsonFromString("[1]")->AsJsonArray().ShareTypedElements() == nullptr);
+}
+
+static void TestLazyConcurrent()
+{
+	std::string Text = "[";
+	for (int i = 0; i < 64; i++) Text += std::string(i ? "," : "") + "{\"a\":[" + std::to_string(i) + ",\"x\"],\"b\":{\"c\":null}}";
+	Text += "]";
+	JsonParseOptions Options;
+	Options.LazyDepth = 1;
+	auto Shared = std::make_shared<const std::string>(Text);
+	auto Lazy = TryParseJsonFromString(Shared, Options).Value;
+	CHECK(Lazy != nullptr);
+	if (!Lazy) return;
+
+	// Const readers on several threads race to load the same deferred containers
+	const JsonData& Root = *Lazy;
+	std::vector<std::string> Seen(4);
+	std::vector<std::thread> Threads;
+	for (size_t t = 0; t < Seen.size(); t++) Threads.emplace_back([&Root, &Seen, t]
+	{
+		for (size_t i = 0; i < Root.AsJsonArray().size(); i++) Seen[t] += Root.AsJsonArray().at(i)->ToString();
+	});
+	for (auto& Thread : Threads) Thread.join();
+	std::string Expected;
+	auto Eager = ParseJsonFromString(Text);
+	for (size_t i = 0; i < Eager->AsJsonArray().size(); i++) Expected += Eager->AsJsonArray().at(i)->ToString();
+	for (auto& s : Seen) CHECK_EQUAL(s, Expected);
+	CHECK(*Lazy == *Eager);
+}
+
+static void TestReusableParser()
+{
+	const char* Texts[] = { "{\"a\": [1, 2.5, \"x\"]}", "[true, {\"b\": null}]", "[1, 2", "\"s\"", "[[1, 2], [3]]" };
+	JsonParseOptions Typed;
+	Typed.TypedArrays = true;
+	JsonParseOptions Lazy;
+	Lazy.LazyDepth = 1;
+	JsonParseOptions Variants[] = { {}, Typed, Lazy };
+	JsonReclaimer Reclaimer;
+	for (auto& Options : Variants)
+	{
+		std::vector<JsonDataPtr> Kept;
+		{
+			JsonReusableParser Parser(Options, 16);
+			for (int Round = 0; Round < 2; Round++) for (auto Text : Texts)
+			{
+				auto Reused = Parser.TryParse(Text);
+				auto Plain = TryParseJsonFromString(Text, Options);
+				CHECK_EQUAL(Reused.Error, Plain.Error);
+				CHECK_EQUAL(Reused.Offset, Plain.Offset);
+				if (Reused && Plain) CHECK(*Reused.Value == *Plain.Value);
+				if (Reused) Kept.push_back(Reused.Value);
+			}
+		}
+		// Documents from a parser without PoolNodes outlive it and may be dropped on another thread
+		for (auto& Json : Kept)
+		{
+			CHECK(!Json->ToString().empty());
+			Reclaimer.Reclaim(std::move(Json));
+		}
+	}
+	Reclaimer.Flush();
+
+#ifdef JSON_USE_PMR
+	// Pooled documents are dropped on this thread before their parser
+	JsonReusableParser Pooled({}, 1 << 16, true);
+	for (int Round = 0; Round < 3; Round++)
+	{
+		auto Json = Pooled.Parse(Texts[0]);
+		CHECK(*Json == *ParseJsonFromString(Texts[0]));
+	}
+#endif
+}
+
+static void TestParallelSerialize()
+{
+	// Large enough to be cut into many chunks, with a split container inside a split one
+	auto Json = MakeJsonObjectPtr(0, 0);
+	for (int i = 0; i < 40; i++)
+	{
+		auto Row = MakeJsonArrayPtr(0, 0);
+		for (int j = 0; j < 50; j++) Row->push_back(j % 3 ? JsonDataPtr(MakeJsonNumberPtr(i * j, 0, 0)) : JsonDataPtr(MakeJsonStringPtr("s" + std::to_string(j), 0, 0)));
+		Json->AsJsonObject()["row" + std::to_string(i)] = Row;
+	}
+
+	JsonTaskPool Pool(3);
+	JsonParallelOptions Options;
+	Options.ChunkNodes = 64;
+	Options.Pool = &Pool;
+	for (int Indent : { 0, 2 })
+	{
+		CHECK_EQUAL(ToStringParallel(*Json, Indent, " ", Options), Json->ToString(Indent));
+		std::string Streamed;
+		size_t Chunks = 0;
+		WriteJsonParallel(*Json, [&](std::string_view Chunk) { Streamed += Chunk; Chunks++; }, Indent, " ", Options);
+		CHECK_EQUAL(Streamed, Json->ToString(Indent));
+		CHECK(Chunks > 1);
+	}
+
+	// Chunks go to the file as they finish, the file reads back the same
+	std::string FilePath = "json_tests_parallel.json";
+	WriteJsonToFile(*Json, FilePath, JsonWriteOptions{}, Options);
+	CHECK_EQUAL(ParseJsonFromFile(FilePath)->ToString(), Json->ToString());
+	std::remove(FilePath.c_str());
+
+	// Calls from several threads share the workers
+	std::vector<std::string> Out(3);
+	std::vector<std::thread> Threads;
+	for (auto& s : Out) Threads.emplace_back([&] { s = ToStringParallel(*Json, 0, " ", Options); });
+	for (auto& Thread : Threads) Thread.join();
+	for (auto& s : Out) CHECK_EQUAL(s, Json->ToString());
+
+	// A failing sink leaves no helper behind on the pool, which goes on working
+	bool Threw = false;
+	try
+	{
+		WriteJsonParallel(*Json, [](std::string_view) { throw std::runtime_error("sink"); }, 0, " ", Options);
+	}
+	catch (const std::runtime_error&)
+	{
+		Threw = true;
+	}
+	CHECK(Threw);
+	CHECK_EQUAL(ToStringParallel(*Json, 0, " ", Options), Json->ToString());
+
+	// One thread is the plain serializer
+	Options.Threads = 1;
+	CHECK_EQUAL(ToStringParallel(*Json, 0, " ", Options), Json->ToString());
+}
+
+#ifdef JSON_USE_PMR
+// Counts what reaches the heap through it
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	size_t CharAllocations = 0;
+
+protected:
+	void* do_allocate(size_t Bytes, size_t Alignment) override
+	{
+		if (Alignment == 1) CharAllocations++;
+		return std::pmr::new_delete_resource()->allocate(Bytes, Alignment);
+	}
+
+	void do_deallocate(void* p, size_t Bytes, size_t Alignment) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, Bytes, Alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& Other) const noexcept override
+	{
+		return this == &Other;
+	}
+};
+
+static void TestInSitu()
+{
+	const std::string Text = "{\"a long key without escapes\": \"a long value without escapes\",\n"
+		"\"escaped\": \"line one\\nline two \\u00e9 \\ud83d\\ude00 \\\"quoted\\\"\",\n"
+		"\"list\": [\"short\", \"another value long enough to allocate\", 1.5, true]}";
+	auto Expected = ParseJsonFromString(Text);
+
+	std::string Buffer = Text;
+	CountingResource Upstream;
+	{
+		JsonInSituResource Resource(Buffer.data(), Buffer.size(), &Upstream);
+		auto Json = ParseJsonInSitu(Resource);
+		CHECK(*Json == *Expected);
+		CHECK_EQUAL(Upstream.CharAllocations, 0u);
+
+		// The long strings and keys keep their characters in the buffer
+		auto InBuffer = [&Buffer](const std::string_view& v) { return v.data() >= Buffer.data() && v.data() < Buffer.data() + Buffer.size(); };
+		auto& Escaped = Json->at("escaped")->AsJsonString();
+		CHECK(InBuffer(Escaped));
+		CHECK(InBuffer(Json->at("list")->at(1)->AsJsonString()));
+		CHECK(InBuffer(Json->AsJsonObject().begin()->first));
+
+		// Positions are worked out from the text before it was rewritten
+		CHECK_EQUAL(Json->at("list")->GetLineNo(), Expected->at("list")->GetLineNo());
+		CHECK_EQUAL(Json->at("list")->at(2)->GetColumn(), Expected->at("list")->at(2)->GetColumn());
+
+		// A string that outgrows its place moves out without touching its neighbours
+		auto& Value = Json->at("list")->at(1)->AsJsonString();
+		Value += " and then some more";
+		CHECK(!InBuffer(Value));
+		CHECK_EQUAL(Json->at("escaped")->AsJsonString(), Expected->at("escaped")->AsJsonString());
+	}
+
+	// Errors are reported where a plain parse reports them
+	const std::string Bad = "[\"a\\nb\",\n\"c\\td\", tru]";
+	Buffer = Bad;
+	JsonInSituResource Resource(Buffer.data(), Buffer.size());
+	auto InSitu = TryParseJsonInSitu(Resource);
+	auto Plain = TryParseJsonFromString(Bad);
+	CHECK_EQUAL(InSitu.Error, Plain.Error);
+	CHECK_EQUAL(InSitu.Offset, Plain.Offset);
+	CHECK_EQUAL(InSitu.LineNo, Plain.LineNo);
+	CHECK_EQUAL(InSitu.Column, Plain.Column);
+}
+#endif
+
+struct TestCase
+{
+	const char* Name;
+	void (*Body)();
+};
+
+static const TestCase Tests[] =
+{
+	{ "validate/accepts", TestValidateAccepts },
+	{ "validate/rejects", TestValidateRejects },
+	{ "schema/keywords", TestSchemaKeywords },
+	{ "schema/unsupported", TestSchemaUnsupported },
+	{ "canonical/numbers", TestCanonicalNumbers },
+	{ "canonical/documents", TestCanonicalDocuments },
+	{ "diff/after-mutation", TestEqualityAfterMutation },
+	{ "deep/no-recursion", TestDeepNesting },
+	{ "numbers/literals", TestNumberLiterals },
+	{ "arrays/typed", TestTypedArrays },
+	{ "lazy/concurrent", TestLazyConcurrent },
+	{ "parser/reused", TestReusableParser },
+	{ "serialize/parallel", TestParallelSerialize },
+#ifdef JSON_USE_PMR
+	{ "parser/in-situ", TestInSitu },
+#endif
+};
+
+int main(int argc, char** argv)
+{
+	const char* Filter = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--filter") && i + 1 < argc) Filter = argv[++i];
+		else
+		{
+			fprintf(stderr, "Usage: %s [--filter <substring>]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	size_t Run = 0;
+	for (auto& Test : Tests)
+	{
+		if (Filter && !strstr(Test.Name, Filter)) continue;
+		size_t FailuresBefore = Failures;
+		try
+		{
+			Test.Body();
+		}
+		catch (std::exception& e)
+		{
+			Failures++;
+			printf("%s: unexpected exception: %s\n", Test.Name, e.what());
+		}
+		printf("%-40s %s\n", Test.Name, Failures == FailuresBefore ? "ok" : "FAILED");
+		Run++;
+	}
+	printf("%zu tests, %zu checks, %zu failures\n", Run, Checks, Failures);
+	return Failures ? 1 : 0;
+}